@@ -0,0 +1,112 @@
+/*******************************************************************************
+* @file           : frame_stream_decoder.c
+* @author         : agent
+* @date           : 18 Oct 2026
+*******************************************************************************/
+
+/*
+******************************************************************************
+* Copyright (c) 2026 TouchNetix
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+******************************************************************************
+*/
+
+/*
+ * Reference decoder for encoded frame stream packets (CMD_FRAME_STREAM_ENCODING = 1), for host tools.
+ * This is NOT part of the bridge firmware - copy it into the host application. Packet format is described in Inc/Frame_Stream.h.
+ *
+ * The host keeps one buffer per stream holding the last frame it decoded. Each packet is applied to that buffer in place, once a packet
+ * with FRAME_ENCODED_END set has been applied the buffer holds the new frame.
+ *
+ * Until the first key frame has been decoded (or after a packet has been lost/rejected) the buffer can't be trusted - throw frames
+ * away until the next packet with FRAME_ENCODED_KEY set at offset 0.
+ */
+
+/*============ Includes ============*/
+#include <stdint.h>
+#include <string.h>
+
+/*============ Defines ============*/
+#define FRAME_STREAM_ENCODED_FLAG   (0x9Du)
+#define FRAME_ENCODED_HEADER_BYTES  (8)
+#define FRAME_ENCODED_MAX_DATA      (64 - FRAME_ENCODED_HEADER_BYTES)
+#define FRAME_ENCODED_KEY           (1u << 0)
+#define FRAME_ENCODED_END           (1u << 1)
+
+#define DECODE_ERROR                (-1)    // not an encoded packet, bad comms status, or the tokens run off the end of the frame
+#define DECODE_MORE                 (0)     // packet applied, more of the frame to come
+#define DECODE_FRAME_DONE           (1)     // packet applied and the frame is complete
+
+/*============ Exported Functions ============*/
+
+/* applies one 64 byte packet to pFrame (wdFrameLength bytes, holding the previous frame)
+ * pwdFrameNumber is set to the packet's frame no. so the caller can spot skipped frames */
+int FrameStream_DecodePacket(const uint8_t *pPacket, uint8_t *pFrame, uint16_t wdFrameLength, uint16_t *pwdFrameNumber)
+{
+    uint16_t wdOffset  = (uint16_t)pPacket[4] | ((uint16_t)pPacket[5] << 8);
+    uint8_t  byLength  = pPacket[6];
+    uint8_t  byFlags   = pPacket[7];
+    const uint8_t *pIn = &pPacket[FRAME_ENCODED_HEADER_BYTES];
+    uint8_t  i = 0;
+    uint8_t  byCount;
+    uint8_t  j;
+
+    if((pPacket[0] != FRAME_STREAM_ENCODED_FLAG) || (pPacket[1] != 0x00) || (byLength > FRAME_ENCODED_MAX_DATA))
+    {
+        return DECODE_ERROR;
+    }
+
+    *pwdFrameNumber = (uint16_t)pPacket[2] | ((uint16_t)pPacket[3] << 8);
+
+    while(i < byLength)
+    {
+        if(pIn[i] & 0x80)
+        {
+            // repeat: next byte, (token & 0x7F) + 1 times
+            byCount = (pIn[i] & 0x7F) + 1;
+            if(((i + 2) > byLength) || ((wdOffset + byCount) > wdFrameLength))
+            {
+                return DECODE_ERROR;
+            }
+            for(j = 0; j < byCount; j++)
+            {
+                pFrame[wdOffset + j] = (byFlags & FRAME_ENCODED_KEY) ? pIn[i + 1] : (pFrame[wdOffset + j] ^ pIn[i + 1]);
+            }
+            i += 2;
+        }
+        else
+        {
+            // literal: token + 1 bytes follow
+            byCount = pIn[i] + 1;
+            if(((i + 1 + byCount) > byLength) || ((wdOffset + byCount) > wdFrameLength))
+            {
+                return DECODE_ERROR;
+            }
+            for(j = 0; j < byCount; j++)
+            {
+                pFrame[wdOffset + j] = (byFlags & FRAME_ENCODED_KEY) ? pIn[i + 1 + j] : (pFrame[wdOffset + j] ^ pIn[i + 1 + j]);
+            }
+            i += 1 + byCount;
+        }
+        wdOffset += byCount;
+    }
+
+    return (byFlags & FRAME_ENCODED_END) ? DECODE_FRAME_DONE : DECODE_MORE;
+}
@@ -0,0 +1,59 @@
+/*******************************************************************************
+* @file           : Block_Write.h
+* @author         : agent
+* @date           : 18 Oct 2026
+*******************************************************************************/
+
+/*
+******************************************************************************
+* Copyright (c) 2026 TouchNetix
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+******************************************************************************
+*/
+
+#ifndef BLOCK_WRITE_H_
+#define BLOCK_WRITE_H_
+
+/*============ Includes ============*/
+#include "stm32f0xx.h"
+#include <stdbool.h>
+
+/*============ Defines ============*/
+// status byte returned in the open response and in each acknowledgement
+#define BLOCK_WRITE_OK                  (0x00u)
+#define BLOCK_WRITE_INVALID             (0x01u)     // bad open parameters, or a packet with more data than the session has left
+#define BLOCK_WRITE_NOT_OPEN            (0x02u)
+#define BLOCK_WRITE_SEQUENCE_ERROR      (0x03u)     // a packet went missing (or was repeated) - session is closed
+#define BLOCK_WRITE_COMMS_ERROR         (0x04u)     // aXiom didn't accept a write - session is closed
+#define BLOCK_WRITE_NOT_READY           (0x05u)     // passthrough: aXiom stayed busy for longer than the timeout - session is closed
+
+#define BLOCK_WRITE_DATA_OFFSET         (3)         // data packet: cmd, sequence no., no. bytes, data...
+
+/*============ Exported Functions ============*/
+uint8_t BlockWrite_Open(uint16_t wdAddress, uint16_t wdLength, uint8_t byWindow);
+uint8_t BlockWrite_OpenPassthrough(uint16_t wdStatusAddress, uint8_t byMask, uint8_t byReady, uint16_t wdTimeoutMs, uint8_t byPollIntervalMs, uint8_t byWindow);
+bool    BlockWrite_Data(uint8_t *pReport, uint8_t byPayloadEnd);
+void    BlockWrite_Close(void);
+bool    BlockWrite_PacketWaiting(void);
+bool    BlockWrite_RetryDue(void);
+void    BlockWrite_Cancel(uint8_t *pReport, uint8_t byPayloadEnd);
+bool    BlockWrite_ToAxiom(uint16_t wdAddress, uint8_t *pData, uint8_t byLength);
+
+#endif /* BLOCK_WRITE_H_ */
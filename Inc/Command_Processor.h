@@ -39,8 +39,18 @@
 extern  bool    boGenericTBPResponseWaiting;
 extern  bool    boPressTBPResponseWaiting;
 extern  uint8_t *pTBPCommandReport;
+extern  bool    boConcurrentCommands;
+extern  bool    boCommandPipelining;
 
 /*============ Exported Functions ============*/
 void ProcessTBPCommand();
+int8_t CommandFIFO_Receive(uint8_t byInterface, uint8_t *pReport);
+uint8_t *CommandFIFO_ReserveControl(void);
+int8_t CommandFIFO_ReceiveControl(uint8_t byInterface);
+void CommandFIFO_Service(void);
+void CommandFIFO_ResponseSent(void);
+void WaitForCondition_Tick(void);
+void BlockWriteData_Tick(void);
+bool RegionCRC_ReadNext(void);
 
 #endif /* COMMAND_PROCESSOR_H_ */
@@ -57,8 +57,9 @@
 
 /*============ Exported Variables ============*/
 extern  bool     boCommsInProcess;
-extern  uint32_t CircularBufferHead;
-extern  uint32_t CircularBufferTail;
+extern  volatile uint32_t CircularBufferHead;
+extern  volatile uint32_t CircularBufferTail;
+extern  uint16_t wdRxBufferOverflows;
 
 extern  uint8_t  comms_mode;
 extern  uint8_t  aXiom_Rx_Buffer[MAX_NUM_RX_BUFFERS][SPI_CMD_BYTES + SPI_PADDING_BYTES + USBD_GENERIC_HID_REPORT_IN_SIZE];
@@ -68,3 +69,8 @@ extern  uint16_t aXiom_NumBytesRx;
 
 /*============ Exported Function ============*/
 HAL_StatusTypeDef Comms_Sequence(void);
+bool     CircularBuffer_IsFull(void);
+bool     CircularBuffer_IsEmpty(void);
+uint32_t CircularBuffer_Count(void);
+bool     CircularBuffer_Push(void);
+void     CircularBuffer_Pop(void);
@@ -42,21 +42,24 @@
 #define RESUMED                     (0)
 #define PENDING_WAKE                (1)
 #define SUSPENDED                   (2)
+#define DIGITIZER_MAX_CONTACTS      (10)    // reported to the host in the Contact Count Maximum feature report (u41 can hold up to 10 touches)
 
 /*============ Exported Variables ============*/
-extern volatile uint16_t wd100usTick;
 extern volatile uint16_t wdUSB1msTick;
 extern          uint8_t  u34_TCP_report[USBD_GENERIC_HID_REPORT_IN_SIZE]; //SPI_CMD_BYTES + SPI_PADDING_BYTES +
 extern          uint8_t  byNumTouches;
-extern          uint8_t  touch_data[5][8];
+extern          uint8_t  touch_data[DIGITIZER_MAX_CONTACTS][8];
 extern          uint8_t  usb_remote_wake_state;
 extern          bool     boUSBTimeoutEnabled;
+extern          bool     boDigitizerDeltaMode;
 extern          uint8_t  wakeup_option;
 
 /*============ Exported Functions ============*/
 void CRC_Checksum(void);
 void MultiPointDigitizer(void);
 void MouseDigitizer(void);
+void MouseRightClickTask(void);
+void RemoteWakeupTask(void);
 void setup_proxy_for_digitizer(void);
 bool Check_u41Report(void);
 uint8_t CheckTouches(void);
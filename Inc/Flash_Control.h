@@ -33,6 +33,8 @@
 
 /*============ Includes ============*/
 #include <stdio.h>
+#include <stdbool.h>
+#include "stm32f0xx.h"
 
 /*============ Exported Variables ============*/
 
@@ -49,5 +51,6 @@ uint8_t check_boot_sel(void);
 void    check_boot_config(void);
 void    write_boot_sel(uint8_t boot_bit);
 void    StartBootloader(void);
+bool    Store_Page_To_Flash(uint32_t PageAddress, uint8_t *pData, uint16_t wdLength);
 
 #endif /* FLASH_CONTROL_H_ */
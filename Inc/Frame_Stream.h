@@ -0,0 +1,96 @@
+/*******************************************************************************
+* @file           : Frame_Stream.h
+* @author         : agent
+* @date           : 18 Oct 2026
+*******************************************************************************/
+
+/*
+******************************************************************************
+* Copyright (c) 2026 TouchNetix
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+******************************************************************************
+*/
+
+#ifndef FRAME_STREAM_H_
+#define FRAME_STREAM_H_
+
+/*============ Includes ============*/
+#include "stm32f0xx.h"
+#include <stdbool.h>
+
+/*============ Defines ============*/
+// what starts a new frame
+#define FRAME_TRIGGER_OFF           (0)
+#define FRAME_TRIGGER_EVERY_REPORT  (1)     // every report read off aXiom (i.e. every nIRQ) - needs proxy (host or internal) running
+#define FRAME_TRIGGER_EVERY_N       (2)     // every n reports read off aXiom
+#define FRAME_TRIGGER_PERIODIC      (3)     // every n ms
+
+/* each packet:
+ *  0:   FRAME_STREAM_FLAG
+ *  1:   comms status
+ *  2-3: frame no. (lo, hi) - goes up on every trigger, so a gap means frames were skipped because the previous one was still being sent
+ *  4-5: byte offset of this packet's data into the frame (lo, hi)
+ *  6+:  data */
+#define FRAME_STREAM_FLAG           (0x9Cu)
+#define FRAME_STREAM_HEADER_BYTES   (6)
+#define FRAME_STREAM_MAX_DATA       (64 - FRAME_STREAM_HEADER_BYTES)
+
+// how frames are sent
+#define FRAME_ENCODING_RAW          (0)
+#define FRAME_ENCODING_XOR_RLE      (1)     // XOR against the previous frame, then run-length encoded
+
+/* encoded packet:
+ *  0:   FRAME_STREAM_ENCODED_FLAG
+ *  1:   comms status
+ *  2-3: frame no. (lo, hi)
+ *  4-5: offset into the frame of the first byte this packet decodes to (lo, hi)
+ *  6:   no. encoded bytes
+ *  7:   FRAME_ENCODED_KEY (data is the frame itself, not a difference) | FRAME_ENCODED_END (last packet of the frame)
+ *  8+:  tokens, never split across packets
+ *       0x00-0x7F: n+1 literal bytes follow
+ *       0x80-0xFF: next byte is repeated (n & 0x7F)+1 times
+ * each decoded byte is XORed into the host's copy of the previous frame (or just stored, for a key frame)
+ * Documents/frame_stream_decoder.c is a reference decoder for host tools */
+#define FRAME_STREAM_ENCODED_FLAG   (0x9Du)
+#define FRAME_ENCODED_HEADER_BYTES  (8)
+#define FRAME_ENCODED_MAX_DATA      (64 - FRAME_ENCODED_HEADER_BYTES)
+#define FRAME_ENCODED_KEY           (1u << 0)
+#define FRAME_ENCODED_END           (1u << 1)
+#define DEFAULT_KEY_FRAME_INTERVAL  (16)
+
+// encoding needs a copy of the last frame sent
+#if defined(STM32F042x6)
+    #define MAX_ENCODED_FRAME_BYTES (256U)
+#elif defined(STM32F070xB) || defined(STM32F072xB) || defined(STM32F072RB_DISCOVERY)
+    #define MAX_ENCODED_FRAME_BYTES (2048U)
+#else
+#error Undefined chip being used! Please set the largest frame that can be encoded (within RAM constraints)
+#endif
+
+/*============ Exported Functions ============*/
+bool     FrameStream_Start(uint8_t byTrigger, uint16_t wdAddress, uint16_t wdLength, uint8_t byPageLength, uint16_t wdInterval);
+void     FrameStream_Stop(void);
+uint16_t FrameStream_GetSkipped(void);
+bool     FrameStream_SetEncoding(uint8_t byEncoding, uint8_t byKeyFrameInterval);
+void     FrameStream_ReportRead(void);
+void     FrameStream_Tick(void);
+bool     FrameStream_ReadNext(void);
+
+#endif /* FRAME_STREAM_H_ */
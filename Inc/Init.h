@@ -56,6 +56,7 @@ extern I2C_HandleTypeDef hi2c_module;
 extern DMA_HandleTypeDef hdma_spi_tx;
 extern DMA_HandleTypeDef hdma_spi_rx;
 extern TIM_HandleTypeDef htim16;
+extern TIM_HandleTypeDef htim17;
 
 /*============ Exported Functions ============*/
 void Device_Init(void);
@@ -56,7 +56,9 @@ void USB_IRQHandler(void);
 void I2C1_IRQHandler(void);
 void DMA1_Channel2_3_IRQHandler(void);
 void SPI1_IRQHandler(void);
+void EXTI0_1_IRQHandler(void);
 void EXTI4_15_IRQHandler(void);
+void TIM17_IRQHandler(void);
 /* USER CODE BEGIN EFP */
 
 /* USER CODE END EFP */
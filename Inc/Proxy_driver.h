@@ -41,12 +41,26 @@
 #define NUMBYTES_RX_MP      (58)
 #define NUMPROXYBYTES_TX     (4)
 #define NUMPROXYBYTES_RX    (64)
+#define MAX_PROXY_FILTER_ENTRIES    (8)
+
+/*============ Exported Structures ============*/
+struct proxyfilter_st
+{
+    uint8_t usagenum;
+    uint8_t decimation;
+    uint8_t counter;
+};
 
 /*============ Exported Variables ============*/
 extern volatile bool    boProxyReportAvailable;
 extern          bool    boProxyEnabled;
 extern          bool    boProxyReportToProcess;
 extern          bool    boInternalProxy;
+extern          bool    boProxyPackedFraming;
+extern          uint16_t wdReportTimestamp;
+extern          bool    boProxyInterruptReady;
+extern struct proxyfilter_st proxy_filter[MAX_PROXY_FILTER_ENTRIES];
+extern          uint8_t byNumProxyFilterEntries;
 
 //-------------- Multipage Read --------------
 extern bool     boReadInProgress;
@@ -59,5 +73,8 @@ extern uint16_t wdProxyMP_BytesRead;
 void InitProxyInterruptMode(void);
 void DeInitProxyInterruptMode(void);
 bool ProxyExecute(bool boMultiPageRead);
+uint8_t *GetNextProxyPacket(void);
+bool SetProxyReportFilter(uint8_t *pFilter, uint8_t byNumEntries);
+bool ProxyReportWanted(void);
 
 #endif /* PROXY_DRIVER_H_ */
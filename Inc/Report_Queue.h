@@ -0,0 +1,82 @@
+/*******************************************************************************
+* @file           : Report_Queue.h
+* @author         : agent
+* @date           : 18 Oct 2026
+*******************************************************************************/
+
+/*
+******************************************************************************
+* Copyright (c) 2026 TouchNetix
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+******************************************************************************
+*/
+
+#ifndef REPORT_QUEUE_H_
+#define REPORT_QUEUE_H_
+
+/*============ Includes ============*/
+#include "stm32f0xx.h"
+#include <stdbool.h>
+
+/*============ Defines ============*/
+// queue policies
+#define QUEUE_LATEST_WINS           (0)     // a new report (frame) replaces anything still waiting - lowest latency
+#define QUEUE_FIFO                  (1)     // reports go out in order, new reports are dropped when the queue is full
+#define QUEUE_MAX_AGE               (2)     // reports go out in order, reports older than max_age_ms are dropped (oldest frame dropped when full)
+
+#define REPORT_QUEUE_ENTRY_SIZE     (64)
+
+// 2 entries is enough for a full hybrid digitizer frame, so the F042 is kept to that to save RAM
+#if defined(STM32F042x6)
+    #define REPORT_QUEUE_DEPTH      (2U)
+#elif defined(STM32F070xB) || defined(STM32F072xB) || defined(STM32F072RB_DISCOVERY)
+    #define REPORT_QUEUE_DEPTH      (4U)
+#else
+#error Undefined chip being used! Please set the report queue depth (within RAM constraints)
+#endif
+
+/*============ Exported Structures ============*/
+struct reportqueue_st
+{
+    uint8_t  report[REPORT_QUEUE_DEPTH][REPORT_QUEUE_ENTRY_SIZE];
+    uint8_t  length[REPORT_QUEUE_DEPTH];
+    uint32_t timestamp[REPORT_QUEUE_DEPTH];     // HAL_GetTick() when the report was queued
+    bool     frame_start[REPORT_QUEUE_DEPTH];   // first packet of a frame, reports are dropped a frame at a time
+    uint8_t  head;
+    uint8_t  tail;
+    uint8_t  count;
+    uint8_t  policy;
+    uint16_t max_age_ms;
+    bool     boDroppingFrame;   // a packet of the frame being pushed was dropped, the rest of it is dropped too
+    uint16_t dropped;       // reports thrown away because they were replaced or the queue was full
+    uint16_t aged_out;      // reports thrown away because the host didn't collect them in time
+};
+
+/*============ Exported Variables ============*/
+extern struct reportqueue_st mouse_report_queue;
+extern struct reportqueue_st press_report_queue;
+
+/*============ Exported Functions ============*/
+bool     ReportQueue_Push(struct reportqueue_st *queue, uint8_t *report, uint8_t length, bool boNewFrame);
+uint8_t *ReportQueue_Peek(struct reportqueue_st *queue, uint8_t *length);
+void     ReportQueue_Pop(struct reportqueue_st *queue);
+void     ReportQueue_Flush(struct reportqueue_st *queue);
+
+#endif /* REPORT_QUEUE_H_ */
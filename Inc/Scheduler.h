@@ -0,0 +1,72 @@
+/*******************************************************************************
+* @file           : Scheduler.h
+* @author         : agent
+* @date           : 18 Oct 2026
+*******************************************************************************/
+
+/*
+******************************************************************************
+* Copyright (c) 2026 TouchNetix
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+******************************************************************************
+*/
+
+#ifndef SCHEDULER_H_
+#define SCHEDULER_H_
+
+/*============ Includes ============*/
+#include "stm32f0xx.h"
+#include <stdbool.h>
+
+/*============ Defines ============*/
+// tasks in priority order - lowest number runs first when several have events waiting
+#define TASK_PROXY_READ     (0)     // read a report off aXiom when nIRQ goes low
+#define TASK_USB_IN         (1)     // send whatever is queued on each IN endpoint
+#define TASK_COMMAND        (2)     // decode a command from the host
+#define TASK_HOUSEKEEPING   (3)     // 1ms tick - startup proxy, mouse clicks, remote wakeup, backstop for missed events
+#define TASK_BLOCK_READ     (4)     // host requested multi-page (3D) read or region CRC, one chunk per run - reposted by USB_IN once the last one has been sent
+#define TASK_FRAME_STREAM   (5)     // reads the next piece of a streamed (3D) frame into the ring
+#define TASK_WATCH_LIST     (6)     // reads the next watch list entry into the sample being sent
+#define TASK_SCRIPT         (7)     // runs the next instruction of the on-bridge script
+#define TASK_USAGE_SNAPSHOT (8)     // reads the next piece of a usage snapshot into the ring
+#define NUM_TASKS           (9)
+
+/*============ Exported Structures ============*/
+struct task_st
+{
+    void     (*pTaskFunction)(void);
+    uint32_t posted_us;         // when the pending event was first posted
+    uint32_t runs;
+    uint32_t total_run_us;
+    uint32_t max_run_us;
+    uint32_t max_latency_us;    // longest wait between an event being posted and the task starting
+};
+
+/*============ Exported Variables ============*/
+extern struct task_st scheduler_tasks[NUM_TASKS];
+
+/*============ Exported Functions ============*/
+uint32_t Scheduler_GetMicros(void);
+void     Scheduler_AddTask(uint8_t byTask, void (*pTaskFunction)(void));
+void     Scheduler_PostEvent(uint8_t byTask);
+void     Scheduler_ClearStats(uint8_t byTask);
+void     Scheduler_Run(void);
+
+#endif /* SCHEDULER_H_ */
@@ -0,0 +1,125 @@
+/*******************************************************************************
+* @file           : Script_Engine.h
+* @author         : agent
+* @date           : 18 Oct 2026
+*******************************************************************************/
+
+/*
+******************************************************************************
+* Copyright (c) 2026 TouchNetix
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+******************************************************************************
+*/
+
+#ifndef SCRIPT_ENGINE_H_
+#define SCRIPT_ENGINE_H_
+
+/*============ Includes ============*/
+#include "stm32f0xx.h"
+#include <stdbool.h>
+
+/*============ Defines ============*/
+/* script bytecode - each instruction is an opcode followed by its operands, addresses and 16 bit values are little endian (lo, hi)
+ *  END                                           stops the script (so does running off the end)
+ *  READ        addr(2) len                       reads len bytes (1 to SCRIPT_MAX_XFER) and appends them to the results
+ *  WRITE       addr(2) len data(len)             writes len bytes (1 to SCRIPT_MAX_XFER)
+ *  DELAY       ms(2)                             waits without holding anything else up
+ *  WAIT        addr(2) mask value timeout_ms(2)  reads the byte (every 1ms) until (byte & mask) == value, fails if it times out
+ *  SKIP_IF_NOT addr(2) mask value n              reads the byte, skips the next n script bytes unless (byte & mask) == value
+ *  SKIP        n                                 skips the next n script bytes
+ *  MARK        byte                              appends byte to the results (so the host can tell which read is which)
+ *  FAIL        code                              stops the script, code is reported as the error (use 0x80+ to keep clear of SCRIPT_ERR_xxx)
+ *  RESET_AXIOM                                   pulses nRESET (follow with a DELAY or WAIT for aXiom to boot)
+ * skips can only go forwards so every script finishes */
+#define SCRIPT_OP_END               (0x00u)
+#define SCRIPT_OP_READ              (0x01u)
+#define SCRIPT_OP_WRITE             (0x02u)
+#define SCRIPT_OP_DELAY             (0x03u)
+#define SCRIPT_OP_WAIT              (0x04u)
+#define SCRIPT_OP_SKIP_IF_NOT       (0x05u)
+#define SCRIPT_OP_SKIP              (0x06u)
+#define SCRIPT_OP_MARK              (0x07u)
+#define SCRIPT_OP_FAIL              (0x08u)
+#define SCRIPT_OP_RESET_AXIOM       (0x09u)
+
+#define SCRIPT_MAX_XFER             (64U)
+
+// events that can start the loaded script (as well as the host asking)
+#define SCRIPT_EVENT_HOST           (0u)
+#define SCRIPT_EVENT_BOOT           (1u << 0)   // only useful with a script stored in flash
+#define SCRIPT_EVENT_AXIOM_RESET    (1u << 1)   // CMD_RESET_AXIOM
+#define SCRIPT_EVENT_COMMS_ERROR    (1u << 2)   // any aXiom transaction failing (ignored while the script runs, and for a while after)
+#define SCRIPT_EVENT_ALL            (SCRIPT_EVENT_BOOT | SCRIPT_EVENT_AXIOM_RESET | SCRIPT_EVENT_COMMS_ERROR)
+
+// status returned by the load/control functions
+#define SCRIPT_OK                   (0x00u)
+#define SCRIPT_INVALID              (0x01u)
+#define SCRIPT_BUSY                 (0x02u)     // can't do that while the script is running
+#define SCRIPT_FLASH_ERROR          (0x03u)     // erase/write failed, or this chip doesn't keep scripts in flash
+
+// run state
+#define SCRIPT_IDLE                 (0u)
+#define SCRIPT_RUNNING              (1u)
+#define SCRIPT_DONE                 (2u)
+#define SCRIPT_FAILED               (3u)
+
+// why the last run failed
+#define SCRIPT_ERR_NONE             (0x00u)
+#define SCRIPT_ERR_COMMS            (0x01u)
+#define SCRIPT_ERR_TIMEOUT          (0x02u)     // WAIT
+#define SCRIPT_ERR_BAD_SCRIPT       (0x03u)     // unknown opcode, bad length, instruction cut short or a skip past the end
+#define SCRIPT_ERR_RESULTS_FULL     (0x04u)
+#define SCRIPT_ERR_STOPPED          (0x05u)     // host stopped it
+
+/* the F042 has neither the RAM nor the flash to spare, so it gets a small script that isn't kept over a power cycle
+ * on the other chips the last page of flash is kept back (see the linker scripts) for a copy of the script */
+#if defined(STM32F042x6)
+    #define SCRIPT_MAX_BYTES        (128U)
+    #define SCRIPT_MAX_RESULTS      (64U)
+#elif defined(STM32F070xB) || defined(STM32F072xB) || defined(STM32F072RB_DISCOVERY)
+    #define SCRIPT_MAX_BYTES        (512U)
+    #define SCRIPT_MAX_RESULTS      (256U)
+    #define SCRIPT_FLASH_ADDRESS    (0x0801F800UL)  // last 2k page of the 128k
+#else
+#error Undefined chip being used! Please set the script sizes (within RAM constraints)
+#endif
+
+/*============ Exported Functions ============*/
+void     Script_Init(void);
+uint8_t  Script_Load(uint16_t wdOffset, uint8_t *pData, uint8_t byLength);
+uint8_t  Script_Run(uint8_t byEvent);
+void     Script_Stop(void);
+uint8_t  Script_SetEventMask(uint8_t byMask);
+uint8_t  Script_Save(void);
+uint8_t  Script_EraseSaved(void);
+void     Script_Event(uint8_t byEvent);
+void     Script_Tick(void);
+bool     Script_Step(void);
+uint8_t  Script_GetState(void);
+uint16_t Script_GetPC(void);
+uint8_t  Script_GetError(void);
+uint8_t  Script_GetEventMask(void);
+uint8_t  Script_GetLastEvent(void);
+uint16_t Script_GetLength(void);
+bool     Script_IsSaved(void);
+uint16_t Script_GetResultLength(void);
+uint8_t  Script_ReadResults(uint16_t wdOffset, uint8_t *pDest, uint8_t byMax);
+
+#endif /* SCRIPT_ENGINE_H_ */
@@ -35,16 +35,15 @@
 #include "stm32f0xx.h"
 #include <stdbool.h>
 
-/*============ Exported Variables ============*/
-extern uint32_t aXiom_activity_counter;
-extern uint32_t USB_activity_counter;
-extern bool     boAxiomActivity;
-extern bool     boUSBActivity;
-extern bool     boFlashAxiomLED;
-extern bool     boFlashUSBLED;
+/*============ Exported Defines ============*/
+#define LED_TICK_MS   (10)    // TIM17 period, resolution of all LED timing
 
-/*============ Exported Functions ============*/
-extern void LED_control(void);
-extern void comms_detect_inactivity(void);
+/*============ Exported Variables ============*/
+extern volatile uint32_t aXiom_activity_counter;
+extern volatile uint32_t USB_activity_counter;
+extern volatile bool     boAxiomActivity;
+extern volatile bool     boUSBActivity;
+extern volatile bool     boFlashAxiomLED;
+extern volatile bool     boFlashUSBLED;
 
 #endif /* TIMERS_AND_LEDS_H_ */
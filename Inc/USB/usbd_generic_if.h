@@ -41,7 +41,6 @@ extern USBD_GENERIC_HID_ItfTypeDef USBD_GenericHID_fops_FS; /** GENERIC_HID Inte
 
 /*============ Exported Variables ============*/
 extern volatile bool boCommandWaitingToDecode;
-extern bool     boGenericReportToSend;
 extern uint8_t *pTBPCommandReportGeneric;
 //uint8_t generic_proxy_array_report_in[2][SPI_CMD_BYTES + SPI_PADDING_BYTES + USBD_GENERIC_HID_REPORT_IN_SIZE];
 
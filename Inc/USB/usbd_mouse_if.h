@@ -37,7 +37,6 @@
 /*============ Exported Macros ============*/
 
 /*============ Exported Variables ============*/
-extern bool    boMouseReportToSend;
 extern uint8_t BridgeMode;
 extern uint8_t byMouseReportLength;
 extern uint8_t usb_hid_mouse_report_in[USBD_MOUSE_HID_REPORT_IN_SIZE];
@@ -36,7 +36,6 @@
 /*============ Exported Macros ============*/
 
 /*============ Exported Variables ============*//*============ Exported Variables ============*/
-extern bool     boPressReportToSend;
 extern uint8_t  usb_hid_press_report_in[USBD_PRESS_HID_REPORT_IN_SIZE]; // buffer used to send report to host
 extern USBD_PRESS_HID_ItfTypeDef USBD_PressHID_fops_FS; /** PRESSHID Interface callback. */
 extern uint8_t *pTBPCommandReportPress;
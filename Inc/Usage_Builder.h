@@ -66,6 +66,9 @@ extern uint8_t  WakeupMode;
 /*============ Exported Function Prototypes ============*/
 uint8_t build_usage_table(void);
 int8_t  find_usage_from_table(uint8_t byUsagenum);
+uint8_t get_num_usages(void);
+uint16_t UsageLengthInBytes(int16_t usage_table_idx);
+uint16_t UsageAddress(int16_t usage_table_idx, uint8_t byPage, uint8_t byOffset);
 void    configure_HID_PARAMETER_IDs(void);
 void    adjust_descriptors_from_HID_PARAMETER_IDs(void);
 
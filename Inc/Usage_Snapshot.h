@@ -0,0 +1,78 @@
+/*******************************************************************************
+* @file           : Usage_Snapshot.h
+* @author         : agent
+* @date           : 18 Oct 2026
+*******************************************************************************/
+
+/*
+******************************************************************************
+* Copyright (c) 2026 TouchNetix
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+******************************************************************************
+*/
+
+#ifndef USAGE_SNAPSHOT_H_
+#define USAGE_SNAPSHOT_H_
+
+/*============ Includes ============*/
+#include "stm32f0xx.h"
+#include <stdbool.h>
+
+/*============ Defines ============*/
+/* each snapshot packet - a restore takes the same packets back, in the same order, with byte 0 set to the restore command:
+ *  0:   USAGE_SNAPSHOT_FLAG
+ *  1:   SNAPSHOT_DATA, SNAPSHOT_END (last packet) or SNAPSHOT_COMMS_ERROR (snapshot abandoned, nothing follows)
+ *  2:   sequence no. (0 for the first packet, wraps at 255)
+ *  3:   usage number
+ *  4:   usage revision (from the usage table) - a restore only writes to the same revision
+ *  5-6: byte offset of this packet's data into the usage (lo, hi)
+ *  7:   no. data bytes
+ *  8+:  data (up to SNAPSHOT_MAX_DATA bytes)
+ * every usage in the table with any pages (i.e. not a report placeholder) is sent in table order, whole usages at a time
+ * a restore checks every usage but doesn't write back the read only ones (u31-u33) or the system manager command usage (u02)
+ * the end packet has no data, byte 3 is the no. usages sent and 8-11 the total no. data bytes (lo first) */
+#define USAGE_SNAPSHOT_FLAG         (0x9Fu)
+#define SNAPSHOT_HEADER_BYTES       (8)
+#define SNAPSHOT_MAX_DATA           (64 - SNAPSHOT_HEADER_BYTES - 1)   // byte 63 is left clear, it's the sequence id when a packet is sent back with command pipelining on
+
+#define SNAPSHOT_DATA               (0x00u)
+#define SNAPSHOT_END                (0x01u)
+#define SNAPSHOT_COMMS_ERROR        (0x02u)
+
+// status byte returned in each restore acknowledgement (same numbering as BLOCK_WRITE_xxx)
+#define USAGE_RESTORE_OK            (0x00u)
+#define USAGE_RESTORE_INVALID       (0x01u)     // bad packet, or data past the end of the usage
+#define USAGE_RESTORE_NOT_OPEN      (0x02u)     // restore has to start with sequence no. 0
+#define USAGE_RESTORE_SEQUENCE_ERROR (0x03u)    // a packet went missing (or was repeated)
+#define USAGE_RESTORE_COMMS_ERROR   (0x04u)
+#define USAGE_RESTORE_MISMATCH      (0x05u)     // usage isn't on this aXiom, or is a different revision/length
+
+#define USAGE_RESTORE_WINDOW        (8U)        // restore packets per acknowledgement
+
+/*============ Exported Functions ============*/
+bool     UsageSnapshot_Start(void);
+void     UsageSnapshot_Stop(void);
+uint8_t  UsageSnapshot_CountUsages(uint32_t *pTotalBytes);
+bool     UsageSnapshot_ReadNext(void);
+void     UsageRestore_Open(void);
+void     UsageRestore_Close(void);
+bool     UsageRestore_Data(uint8_t *pReport, uint8_t byPayloadEnd);
+
+#endif /* USAGE_SNAPSHOT_H_ */
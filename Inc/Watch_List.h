@@ -0,0 +1,77 @@
+/*******************************************************************************
+* @file           : Watch_List.h
+* @author         : agent
+* @date           : 18 Oct 2026
+*******************************************************************************/
+
+/*
+******************************************************************************
+* Copyright (c) 2026 TouchNetix
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+******************************************************************************
+*/
+
+#ifndef WATCH_LIST_H_
+#define WATCH_LIST_H_
+
+/*============ Includes ============*/
+#include "stm32f0xx.h"
+#include <stdbool.h>
+
+/*============ Defines ============*/
+// what starts a sample of every entry
+#define WATCH_TRIGGER_OFF           (0)
+#define WATCH_TRIGGER_EVERY_REPORT  (1)     // every report read off aXiom (i.e. every nIRQ) - needs proxy (host or internal) running
+#define WATCH_TRIGGER_PERIODIC      (2)     // every n ms
+
+// entry flags
+#define WATCH_ON_CHANGE             (1u << 0)   // only sent when its bytes differ from the last time it was sent
+
+#define WATCH_READ_FAILED           (0x80u)     // set in an entry's index byte, no data follows
+
+/* each packet:
+ *  0:   WATCH_LIST_FLAG
+ *  1:   no. entries in this packet
+ *  2-3: sample no. (lo, hi) - goes up on every trigger, a sample with nothing to send (on-change entries) isn't sent at all
+ *  4-5: TIM16 timestamp of the trigger (100us ticks, same clock as the proxy report timestamps)
+ *  6+:  for each entry: index, then its bytes
+ * a sample that doesn't fit in one packet carries on in the next, with the same sample no. and timestamp */
+#define WATCH_LIST_FLAG             (0x9Eu)
+#define WATCH_HEADER_BYTES          (6)
+
+#if defined(STM32F042x6)
+    #define MAX_WATCH_ENTRIES       (4U)
+    #define MAX_WATCH_BYTES         (16U)
+#elif defined(STM32F070xB) || defined(STM32F072xB) || defined(STM32F072RB_DISCOVERY)
+    #define MAX_WATCH_ENTRIES       (8U)
+    #define MAX_WATCH_BYTES         (32U)
+#else
+#error Undefined chip being used! Please set the watch list size (within RAM constraints)
+#endif
+
+/*============ Exported Functions ============*/
+bool     WatchList_SetEntry(uint8_t byIndex, uint16_t wdAddress, uint8_t byLength, uint8_t byFlags);
+bool     WatchList_Start(uint8_t byTrigger, uint16_t wdPeriodMs);
+uint16_t WatchList_GetSkipped(void);
+void     WatchList_ReportRead(void);
+void     WatchList_Tick(void);
+bool     WatchList_SampleNext(void);
+
+#endif /* WATCH_LIST_H_ */
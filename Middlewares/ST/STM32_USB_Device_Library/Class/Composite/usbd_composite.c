@@ -60,6 +60,7 @@
 #include "Mode_Control.h"
 #include "Digitizer.h"
 #include "Timers_and_LEDs.h"
+#include "Scheduler.h"
 
 // CUSTOMISED
 /*============ Defines ============*/
@@ -394,6 +395,8 @@ static uint8_t  *USBD_COMPOSITE_HID_GetCfgDesc (uint16_t *length)
 static uint8_t  USBD_COMPOSITE_HID_DataIn (USBD_HandleTypeDef *pdev,
                               uint8_t epnum)
 {
+    Scheduler_PostEvent(TASK_USB_IN);   // endpoint is free again, anything queued behind it can go
+
     /* identify which interface host is talking to */
     if(epnum == GENERIC_EPIN_IDX)
         return USBD_GENERIC_HID_DataIn(pdev, epnum);
@@ -437,7 +440,9 @@ static uint8_t  USBD_COMPOSITE_HID_DataOut (USBD_HandleTypeDef *pdev,
   */
 uint8_t USBD_COMPOSITE_HID_EP0_RxReady(USBD_HandleTypeDef *pdev)
 {
-    return USBD_GENERIC_HID_EP0_RxReady(pdev);
+    // CUSTOMISED - a SET_REPORT can be addressed to the generic or press interface, each class only acts if it was the one set up for it
+    USBD_GENERIC_HID_EP0_RxReady(pdev);
+    return USBD_PRESS_HID_EP0_RxReady(pdev);
 }
 
 /**
@@ -458,11 +463,11 @@ static uint8_t  *USBD_COMPOSITE_HID_GetDeviceQualifierDesc (uint16_t *length)
  * @param pdev - pointer to usb device handle
  * @param report - pointer to data buffer to send
  * @param len - length of data to send
- * @return status - HAL status check
+ * @return status - HAL status check, USBD_BUSY if reports are blocked (nothing was sent, the caller keeps hold of the report)
  */
 uint8_t Send_USB_Report(uint8_t interface,USBD_HandleTypeDef  *pdev, uint8_t *report, uint16_t len)
 {
-    uint8_t status = 0;
+    uint8_t status = USBD_BUSY;
 
     if(boBlockReports == 0) // prevents proxy reports 'gumming up' the host usb buffer when a response is expected
     {
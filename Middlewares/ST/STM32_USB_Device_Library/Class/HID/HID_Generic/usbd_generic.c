@@ -270,10 +270,19 @@ uint8_t  USBD_GENERIC_HID_Setup (USBD_HandleTypeDef *pdev,
       break;
 
     case GENERIC_HID_REQ_SET_REPORT:
-      hhid->IsReportAvailable = 1;
-      USBD_CtlPrepareRx (pdev, hhid->Report_buf, (uint8_t)(req->wLength));
+    {
+      // CUSTOMISED - the data goes into a buffer held back for it in the command FIFO, stalled if the FIFO is full so the command isn't lost
+      uint8_t *pbuf = ((USBD_GENERIC_HID_ItfTypeDef *)pdev->pClassSpecificInterfaceGENERIC)->ControlOutReserve();
 
+      if(pbuf == NULL)
+      {
+        USBD_CtlError (pdev, req);
+        return USBD_FAIL;
+      }
+      hhid->IsReportAvailable = 1;
+      USBD_CtlPrepareRx (pdev, pbuf, (uint8_t)(req->wLength));
       break;
+    }
     default:
       USBD_CtlError (pdev, req);
       return USBD_FAIL;
@@ -404,7 +413,30 @@ uint8_t  USBD_GENERIC_HID_DataOut (USBD_HandleTypeDef *pdev,
 
   USBD_GENERIC_HID_HandleTypeDef     *hhid = (USBD_GENERIC_HID_HandleTypeDef*)pdev->pClassDataGENERIC;
 
-  ((USBD_GENERIC_HID_ItfTypeDef *)pdev->pClassSpecificInterfaceGENERIC)->OutEvent(hhid->Report_buf);
+  // CUSTOMISED - if the command FIFO is now full the endpoint is left un-armed (host gets NAKed) until USBD_GENERIC_HID_ReceiveNext() is called
+  if(((USBD_GENERIC_HID_ItfTypeDef *)pdev->pClassSpecificInterfaceGENERIC)->OutEvent(hhid->Report_buf) == USBD_OK)
+  {
+    USBD_LL_PrepareReceive(pdev, GENERIC_HID_EPOUT , hhid->Report_buf,
+                           USBD_GENERIC_HID_OUTREPORT_BUF_SIZE);
+  }
+
+  return USBD_OK;
+}
+
+/**
+  * @brief  USBD_GENERIC_HID_ReceiveNext
+  *         re-arms the OUT endpoint after OutEvent held it off
+  * @param  pdev: device instance
+  * @retval status
+  */
+uint8_t USBD_GENERIC_HID_ReceiveNext(USBD_HandleTypeDef *pdev)
+{
+  USBD_GENERIC_HID_HandleTypeDef     *hhid = (USBD_GENERIC_HID_HandleTypeDef*)pdev->pClassDataGENERIC;
+
+  if(hhid == NULL)
+  {
+    return USBD_FAIL;
+  }
 
   USBD_LL_PrepareReceive(pdev, GENERIC_HID_EPOUT , hhid->Report_buf,
                          USBD_GENERIC_HID_OUTREPORT_BUF_SIZE);
@@ -424,7 +456,7 @@ uint8_t USBD_GENERIC_HID_EP0_RxReady(USBD_HandleTypeDef *pdev)
 
   if (hhid->IsReportAvailable == 1)
   {
-    ((USBD_GENERIC_HID_ItfTypeDef *)pdev->pClassSpecificInterfaceGENERIC)->OutEvent(hhid->Report_buf);
+    ((USBD_GENERIC_HID_ItfTypeDef *)pdev->pClassSpecificInterfaceGENERIC)->ControlOutEvent(); // CUSTOMISED
     hhid->IsReportAvailable = 0;
   }
 
@@ -321,7 +321,7 @@ uint8_t  USBD_MOUSE_HID_Setup (USBD_HandleTypeDef *pdev,
 // CUSTOMISED BEGIN - this isn't included by default (WHY ST??)
     case MOUSE_HID_REQ_GET_REPORT:
         u34_TCP_report[0] = 0x02u;  // report ID
-        u34_TCP_report[1] = 0x05u;  // max no. contacts
+        u34_TCP_report[1] = DIGITIZER_MAX_CONTACTS;  // max no. contacts
         USBD_CtlSendData(pdev, u34_TCP_report, req->wLength);
         break;
 // CUSTOMISED END
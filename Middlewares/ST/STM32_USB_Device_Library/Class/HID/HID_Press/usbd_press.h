@@ -65,6 +65,8 @@ typedef struct _USBD_PRESS_HID_Itf
   int8_t (* Init)          (void);
   int8_t (* DeInit)        (void);
   int8_t (* OutEvent)      (uint8_t*);
+  uint8_t* (* ControlOutReserve) (void);  // CUSTOMISED - SET_REPORT setup stage, returns the buffer for the data (NULL stalls the request)
+  int8_t (* ControlOutEvent) (void);      // CUSTOMISED - SET_REPORT data stage has arrived in that buffer
 
 }USBD_PRESS_HID_ItfTypeDef;
 
@@ -136,6 +138,8 @@ uint8_t  USBD_PRESS_HID_DataIn (USBD_HandleTypeDef *pdev, uint8_t epnum);
 uint8_t  USBD_PRESS_HID_DataOut (USBD_HandleTypeDef *pdev, uint8_t epnum);
 uint8_t  USBD_PRESS_HID_EP0_RxReady (USBD_HandleTypeDef  *pdev);
 
+uint8_t  USBD_PRESS_HID_ReceiveNext (USBD_HandleTypeDef *pdev);
+
 /**
   * @}
   */
@@ -0,0 +1,371 @@
+/*******************************************************************************
+* @file           : Block_Write.c
+* @author         : agent
+* @date           : 18 Oct 2026
+*******************************************************************************/
+
+/*
+******************************************************************************
+* Copyright (c) 2026 TouchNetix
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+******************************************************************************
+*/
+
+/*============ Includes ============*/
+#include "stm32f0xx.h"
+#include "stm32f0xx_hal.h"
+#include <string.h>
+#include <stdbool.h>
+#include "Block_Write.h"
+#include "Comms.h"
+
+/*============ Defines ============*/
+#define WRITE                   (0x00u)
+#define READ                    (0x80u)
+#define AXIOM_PAGE_SIZE         (256U)  // aXiom addresses are page:offset, a single write can't run past the end of a page
+#define DEFAULT_READY_TIMEOUT_MS (1000U)
+#define DEFAULT_POLL_INTERVAL_MS (1U)    // the housekeeping tick, so at most one status read per ms
+
+// aXiom status, passthrough sessions
+#define AXIOM_READY             (0)
+#define AXIOM_BUSY              (1)
+#define AXIOM_TIMED_OUT         (2)
+
+// session types
+#define SESSION_BLOCK_WRITE     (0)     // data is written to consecutive aXiom addresses
+#define SESSION_PASSTHROUGH     (1)     // each packet is a raw aXiom transaction (bootloader), aXiom is polled until ready before the next one
+
+/*============ Local Structures ============*/
+struct blockwrite_st
+{
+    bool     boOpen;
+    uint8_t  type;          // SESSION_xxx
+    uint16_t address;       // where the next byte goes
+    uint16_t remaining;     // bytes still to come
+    uint16_t written;       // bytes written since the session was opened (wraps in passthrough sessions)
+    uint8_t  window;        // data packets per acknowledgement
+    uint8_t  unacked;       // data packets since the last acknowledgement
+    uint8_t  sequence;      // sequence no. expected on the next data packet
+    // passthrough only - aXiom is ready for the next transaction when (status & mask) == ready
+    uint16_t status_address;
+    uint8_t  status_mask;
+    uint8_t  ready_value;
+    uint16_t ready_timeout_ms;
+    uint8_t  poll_interval_ms;
+    bool     boWaitForReady; // a transaction has been sent that aXiom may still be busy with
+    uint32_t busy_since_ms;  // when it was sent
+    uint32_t last_poll_ms;
+    bool     boPacketWaiting; // the last data packet wasn't sent as aXiom was still busy, the caller passes it in again
+};
+
+/*============ Local Variables ============*/
+struct blockwrite_st block_write = {0};
+
+/*============ Local Function Prototypes ============*/
+static bool PassthroughToAxiom(uint8_t *pData, uint8_t byLength);
+static uint8_t PollReady(void);
+static void Acknowledge(uint8_t *pReport, uint8_t byPayloadEnd, uint8_t byStatus);
+
+/*============ Local Functions ============*/
+
+// sends the host's bytes as they are (same as CMD_AXIOM_COMMS) - the host has already built the aXiom header
+static bool PassthroughToAxiom(uint8_t *pData, uint8_t byLength)
+{
+    memcpy(aXiom_Tx_Buffer, pData, byLength);
+    aXiom_NumBytesTx = byLength;
+    aXiom_NumBytesRx = 0;
+
+    (void)Comms_Sequence();
+
+    return ((aXiom_Rx_Buffer[CircularBufferHead][0] == COMMS_OK) || (aXiom_Rx_Buffer[CircularBufferHead][0] == COMMS_OK_NO_READ));
+}
+
+/*-----------------------------------------------------------*/
+
+/* reads aXiom's status once to see if it's finished with the last transaction - checked before the next one is sent (rather than
+ * straight after each write) so aXiom's busy time overlaps with the next packet coming over USB
+ * returns AXIOM_READY, AXIOM_BUSY (read again later, the caller doesn't wait) or AXIOM_TIMED_OUT */
+static uint8_t PollReady(void)
+{
+    if(block_write.boWaitForReady == false)
+    {
+        return AXIOM_READY;
+    }
+
+    aXiom_Tx_Buffer[0] = (uint8_t)(block_write.status_address & 0xFF);
+    aXiom_Tx_Buffer[1] = (uint8_t)(block_write.status_address >> 8);
+    aXiom_Tx_Buffer[2] = 1;
+    aXiom_Tx_Buffer[3] = READ;
+    aXiom_NumBytesTx = 4;
+    aXiom_NumBytesRx = 1;
+
+    (void)Comms_Sequence();
+    block_write.last_poll_ms = HAL_GetTick();
+
+    // aXiom can NAK/return rubbish while it's busy, so a comms error is just treated as not ready yet
+    if((aXiom_Rx_Buffer[CircularBufferHead][0] == COMMS_OK) &&
+       ((aXiom_Rx_Buffer[CircularBufferHead][2] & block_write.status_mask) == block_write.ready_value))
+    {
+        block_write.boWaitForReady = false;
+        return AXIOM_READY;
+    }
+
+    return ((block_write.last_poll_ms - block_write.busy_since_ms) >= block_write.ready_timeout_ms) ? AXIOM_TIMED_OUT : AXIOM_BUSY;
+}
+
+/*-----------------------------------------------------------*/
+
+// overwrites the data packet with the acknowledgement
+static void Acknowledge(uint8_t *pReport, uint8_t byPayloadEnd, uint8_t byStatus)
+{
+    pReport[1] = byStatus;
+    pReport[2] = (uint8_t)(block_write.sequence - 1);
+    pReport[3] = (uint8_t)(block_write.written & 0xFF);
+    pReport[4] = (uint8_t)(block_write.written >> 8);
+    pReport[5] = (uint8_t)(block_write.remaining & 0xFF);
+    pReport[6] = (uint8_t)(block_write.remaining >> 8);
+    memset(&pReport[7], 0, byPayloadEnd - 7);
+}
+
+/*============ Exported Functions ============*/
+
+// starts a session, a length of 0 just closes any session that's open
+uint8_t BlockWrite_Open(uint16_t wdAddress, uint16_t wdLength, uint8_t byWindow)
+{
+    BlockWrite_Close();
+
+    if(wdLength == 0)
+    {
+        return BLOCK_WRITE_OK;
+    }
+
+    if(((uint32_t)wdAddress + wdLength) > 0x10000UL)
+    {
+        return BLOCK_WRITE_INVALID;
+    }
+
+    block_write.type      = SESSION_BLOCK_WRITE;
+    block_write.address   = wdAddress;
+    block_write.remaining = wdLength;
+    block_write.window    = (byWindow == 0) ? 1 : byWindow;
+    block_write.boOpen    = true;
+
+    return BLOCK_WRITE_OK;
+}
+
+/*-----------------------------------------------------------*/
+
+/* starts a passthrough session for aXiom's bootloader - every data packet is sent to aXiom as a raw transaction, after which the
+ * status byte at wdStatusAddress is polled (locally, every byPollIntervalMs) until (status & byMask) == byReady before the next packet
+ * is sent. The session ends with an empty data packet, which is always acknowledged once aXiom is ready */
+uint8_t BlockWrite_OpenPassthrough(uint16_t wdStatusAddress, uint8_t byMask, uint8_t byReady, uint16_t wdTimeoutMs, uint8_t byPollIntervalMs, uint8_t byWindow)
+{
+    BlockWrite_Close();
+
+    if((byReady & ~byMask) != 0)
+    {
+        return BLOCK_WRITE_INVALID; // would never be ready
+    }
+
+    block_write.type             = SESSION_PASSTHROUGH;
+    block_write.status_address   = wdStatusAddress;
+    block_write.status_mask      = byMask;
+    block_write.ready_value      = byReady;
+    block_write.ready_timeout_ms = (wdTimeoutMs == 0) ? DEFAULT_READY_TIMEOUT_MS : wdTimeoutMs;
+    block_write.poll_interval_ms = (byPollIntervalMs == 0) ? DEFAULT_POLL_INTERVAL_MS : byPollIntervalMs;
+    block_write.window           = (byWindow == 0) ? 1 : byWindow;
+    block_write.boOpen           = true;
+
+    return BLOCK_WRITE_OK;
+}
+
+/*-----------------------------------------------------------*/
+
+/* writes the data in one streamed packet, no response is needed unless this packet completes a window, finishes the session or fails
+ * in a passthrough session the data is a raw aXiom transaction, and an empty packet ends the session - if aXiom is still busy with the
+ * last one the packet isn't sent (BlockWrite_PacketWaiting()), the caller passes it in again once BlockWrite_RetryDue()
+ * returns true if pReport has been overwritten with an acknowledgement that should be sent to the host
+ * acknowledgement - 1: status, 2: sequence no. of the last packet written, 3-4: bytes written, 5-6: bytes still to come */
+bool BlockWrite_Data(uint8_t *pReport, uint8_t byPayloadEnd)
+{
+    uint8_t bySequence = pReport[1];
+    uint8_t byLength   = pReport[2];
+    uint8_t byStatus   = BLOCK_WRITE_OK;
+    uint8_t byReady;
+    bool    boAck      = false;
+    bool    boFinished = false;
+
+    block_write.boPacketWaiting = false;
+
+    if(block_write.boOpen == false)
+    {
+        byStatus = BLOCK_WRITE_NOT_OPEN;
+    }
+    else if(bySequence != block_write.sequence)
+    {
+        byStatus = BLOCK_WRITE_SEQUENCE_ERROR;
+    }
+    else if(block_write.type == SESSION_PASSTHROUGH)
+    {
+        if(byLength > (byPayloadEnd - BLOCK_WRITE_DATA_OFFSET))
+        {
+            byStatus = BLOCK_WRITE_INVALID;
+        }
+        else if((byReady = PollReady()) == AXIOM_BUSY)
+        {
+            block_write.boPacketWaiting = true;
+            return false;
+        }
+        else if(byReady == AXIOM_TIMED_OUT)
+        {
+            byStatus = BLOCK_WRITE_NOT_READY;
+        }
+        else if(byLength == 0)
+        {
+            // end of the update - aXiom has finished with the last transaction
+            block_write.sequence++;
+            boFinished = true;
+        }
+        else if(PassthroughToAxiom(&pReport[BLOCK_WRITE_DATA_OFFSET], byLength) == false)
+        {
+            byStatus = BLOCK_WRITE_COMMS_ERROR;
+        }
+        else
+        {
+            block_write.boWaitForReady = true;
+            block_write.busy_since_ms  = HAL_GetTick();
+            block_write.written += byLength;
+            block_write.sequence++;
+            block_write.unacked++;
+        }
+    }
+    else if((byLength == 0) || (byLength > (byPayloadEnd - BLOCK_WRITE_DATA_OFFSET)) || (byLength > block_write.remaining))
+    {
+        byStatus = BLOCK_WRITE_INVALID;
+    }
+    else if(BlockWrite_ToAxiom(block_write.address, &pReport[BLOCK_WRITE_DATA_OFFSET], byLength) == false)
+    {
+        byStatus = BLOCK_WRITE_COMMS_ERROR;
+    }
+    else
+    {
+        block_write.address   += byLength;
+        block_write.remaining -= byLength;
+        block_write.written   += byLength;
+        block_write.sequence++;
+        block_write.unacked++;
+        boFinished = (block_write.remaining == 0);
+    }
+
+    if((byStatus == BLOCK_WRITE_OK) && ((block_write.unacked >= block_write.window) || boFinished))
+    {
+        block_write.unacked = 0;
+        boAck = true;
+    }
+
+    if(byStatus != BLOCK_WRITE_OK)
+    {
+        // session is closed below - for a block write the host re-opens at the address after the bytes written and carries on from there
+        boAck = true;
+    }
+
+    if(boAck)
+    {
+        Acknowledge(pReport, byPayloadEnd, byStatus);
+    }
+
+    if((byStatus != BLOCK_WRITE_OK) || boFinished)
+    {
+        BlockWrite_Close();
+    }
+
+    return boAck;
+}
+
+/*-----------------------------------------------------------*/
+
+void BlockWrite_Close(void)
+{
+    memset(&block_write, 0, sizeof(block_write));
+}
+
+/*-----------------------------------------------------------*/
+
+// the last data packet is waiting for aXiom to be ready (passthrough sessions only)
+bool BlockWrite_PacketWaiting(void)
+{
+    return block_write.boPacketWaiting;
+}
+
+/*-----------------------------------------------------------*/
+
+// the waiting packet should be passed into BlockWrite_Data() again - checked every 1ms, aXiom is read at the session's poll interval
+bool BlockWrite_RetryDue(void)
+{
+    return (block_write.boPacketWaiting && ((HAL_GetTick() - block_write.last_poll_ms) >= block_write.poll_interval_ms));
+}
+
+/*-----------------------------------------------------------*/
+
+// gives up on the waiting packet (host cancelled it) - acknowledged as if aXiom had timed out, and the session is closed
+void BlockWrite_Cancel(uint8_t *pReport, uint8_t byPayloadEnd)
+{
+    Acknowledge(pReport, byPayloadEnd, BLOCK_WRITE_NOT_READY);
+    BlockWrite_Close();
+}
+
+/*-----------------------------------------------------------*/
+
+/* writes to consecutive aXiom addresses (block write sessions and the usage restore), split wherever the write crosses a page boundary
+ * SPI padding etc. is all taken care of by Comms_Sequence() */
+bool BlockWrite_ToAxiom(uint16_t wdAddress, uint8_t *pData, uint8_t byLength)
+{
+    uint16_t wdChunk;
+
+    while(byLength > 0)
+    {
+        wdChunk = AXIOM_PAGE_SIZE - (wdAddress & (AXIOM_PAGE_SIZE - 1));
+        if(wdChunk > byLength)
+        {
+            wdChunk = byLength;
+        }
+
+        aXiom_Tx_Buffer[0] = (uint8_t)(wdAddress & 0xFF);
+        aXiom_Tx_Buffer[1] = (uint8_t)(wdAddress >> 8);
+        aXiom_Tx_Buffer[2] = (uint8_t)wdChunk;
+        aXiom_Tx_Buffer[3] = WRITE;
+        memcpy(&aXiom_Tx_Buffer[4], pData, wdChunk);
+        aXiom_NumBytesTx = 4 + wdChunk;
+        aXiom_NumBytesRx = 0;
+
+        (void)Comms_Sequence();
+
+        if((aXiom_Rx_Buffer[CircularBufferHead][0] != COMMS_OK) && (aXiom_Rx_Buffer[CircularBufferHead][0] != COMMS_OK_NO_READ))
+        {
+            return false;
+        }
+
+        wdAddress += wdChunk;
+        pData     += wdChunk;
+        byLength  -= wdChunk;
+    }
+
+    return true;
+}
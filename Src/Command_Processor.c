@@ -46,6 +46,13 @@
 #include "Mode_Control.h"
 #include "usb_device.h"
 #include "Timers_and_LEDs.h"
+#include "Report_Queue.h"
+#include "Scheduler.h"
+#include "Block_Write.h"
+#include "Frame_Stream.h"
+#include "Watch_List.h"
+#include "Script_Engine.h"
+#include "Usage_Snapshot.h"
 
 /*============ Defines ============*/
 #define READ                            (0x80)
@@ -60,6 +67,45 @@
 #define ID_F042                         (0x0Au)
 #define ID_F070                         (0x0Bu)
 #define ID_F072                         (0x0Cu)
+#define COMMAND_ENTRY_SIZE              (64)
+#define COMMAND_SEQUENCE_BYTE           (COMMAND_ENTRY_SIZE - 1)   // pipelining: host puts a sequence id in the last byte, it's echoed back in the response
+#define BATCH_OP_HEADER_BYTES           (4)     // address lo, address hi, length, READ/WRITE
+#define BATCH_RESULT_HEADER_BYTES       (3)     // command echo, status, no. operations run
+#define BATCH_OP_NOT_RUN                (0xFFu) // per-operation status for anything after a failed operation
+#define WAIT_CONDITION_MET              (0x00u)
+#define WAIT_TIMED_OUT                  (0x02u)
+#define WAIT_CANCELLED                  (0x04u)
+#define WAIT_EQUAL                      (0)     // done when (value & mask) == expected
+#define WAIT_NOT_EQUAL                  (1)     // done when (value & mask) != expected
+#define CRC_MATCH                       (0x00u)
+#define CRC_MISMATCH                    (0x02u)
+#define CRC_COMMS_ERROR                 (0x03u)
+#define CRC_CANCELLED                   (0x04u)
+#define CRC_COMPARE                     (1u << 0)
+#define CRC_READ_CHUNK                  (USBD_GENERIC_HID_REPORT_IN_SIZE)   // bytes per aXiom read (Rx buffer has room for the SPI padding on top)
+#define AXIOM_PAGE_SIZE                 (256U)
+#define MODIFY_REPLACE                  (0)     // masked bits are set to the value's bits
+#define MODIFY_TOGGLE                   (1)     // masked bits are flipped
+#define SCRIPT_ACTION_STATUS            (0)     // CMD_SCRIPT_CONTROL actions
+#define SCRIPT_ACTION_RUN               (1)
+#define SCRIPT_ACTION_STOP              (2)
+#define SCRIPT_ACTION_SET_EVENTS        (3)
+#define SCRIPT_ACTION_SAVE              (4)
+#define SCRIPT_ACTION_ERASE_SAVED       (5)
+#define SCRIPT_LOAD_HEADER_BYTES        (4)     // command, offset lo, offset hi, no. bytes
+#define SCRIPT_RESULTS_HEADER_BYTES     (6)     // command, status, state, total lo, total hi, no. bytes
+#define SNAPSHOT_ACTION_STOP            (0)     // CMD_USAGE_SNAPSHOT actions
+#define SNAPSHOT_ACTION_START           (1)
+#define SNAPSHOT_ACTION_OPEN_RESTORE    (2)
+
+// commands are small so the other chips can afford to have a few more in flight
+#if defined(STM32F042x6)
+    #define COMMAND_FIFO_DEPTH          (2U)
+#elif defined(STM32F070xB) || defined(STM32F072xB) || defined(STM32F072RB_DISCOVERY)
+    #define COMMAND_FIFO_DEPTH          (4U)   // must be a power of 2 (free-running head/tail)
+#else
+#error Undefined chip being used! Please set the command FIFO depth (within RAM constraints)
+#endif
 
 /*------------TBP COMMANDS------------*/
 #define CMD_ZERO                        (0x00u)     /* TH2 will call this as it exits - stops proxy mode, starts counter to re-enable proxy mode once it has closed */
@@ -76,6 +122,30 @@
 
 //------------Mode switch Commands
 #define CMD_BLOCK_DIGITIZER_REPORTS     (0x87u)     /* enables/disables mouse reports */
+#define CMD_DIGITIZER_DELTA_REPORTS     (0x89u)     /* enables/disables delta digitizer reports (only active/lifted contacts, repeats dropped) */
+#define CMD_REPORT_QUEUE_CONFIG         (0x8Au)     /* reads/sets the mouse and press report queue policies, returns the drop counters */
+#define CMD_PROXY_PACKED_FRAMING        (0x8Cu)     /* enables/disables packing several proxy reports into each generic packet */
+#define CMD_PROXY_REPORT_FILTER         (0x8Du)     /* sets which report usages are forwarded in proxy mode (and how often) */
+#define CMD_SCHEDULER_STATS             (0x8Eu)     /* returns the run count, run time and latency figures for one of the main loop tasks */
+#define CMD_CONCURRENT_COMMANDS         (0x8Fu)     /* enables/disables commands running alongside proxy streaming (rather than stopping it) */
+#define CMD_COMMAND_PIPELINING          (0x90u)     /* enables/disables sequence ids (last byte of each command, echoed in the response) */
+#define CMD_AXIOM_BATCH                 (0x91u)     /* runs a list of aXiom reads/writes back to back, all results returned in one response */
+#define CMD_BLOCK_WRITE_OPEN            (0x92u)     /* starts a streamed write of a large block (e.g. a config) to aXiom */
+#define CMD_BLOCK_WRITE_DATA            (0x93u)     /* one packet of a streamed write - only acknowledged every n packets */
+#define CMD_FW_UPDATE_OPEN              (0x94u)     /* starts a streamed aXiom bootloader passthrough, data is then sent with CMD_BLOCK_WRITE_DATA */
+#define CMD_FRAME_STREAM                (0x95u)     /* starts/stops continuous streaming of a (3D) data region, a frame per trigger */
+#define CMD_FRAME_STREAM_ENCODING       (0x96u)     /* sets whether streamed frames are sent raw or delta/run-length encoded */
+#define CMD_WATCH_LIST_ENTRY            (0x97u)     /* sets up one entry (address, length) of the register watch list */
+#define CMD_WATCH_LIST_START            (0x98u)     /* starts/stops sampling the watch list, on every report or every n ms */
+#define CMD_WAIT_FOR_CONDITION          (0xA4u)     /* polls an aXiom address until (value & mask) matches, only responds once it does (or times out) */
+#define CMD_REGION_CRC                  (0xA5u)     /* reads an aXiom address range on the bridge and returns (or checks) its CRC32 */
+#define CMD_MODIFY_USAGE                (0xA6u)     /* read-modify-write of a field in a usage, done on the bridge */
+#define CMD_SCRIPT_LOAD                 (0xA7u)     /* loads (a piece of) a script of aXiom transactions for the bridge to run itself */
+#define CMD_SCRIPT_CONTROL              (0xA8u)     /* runs/stops the script, sets which events start it, saves it to flash */
+#define CMD_SCRIPT_RESULTS              (0xA9u)     /* reads back what the script has read */
+#define CMD_USAGE_SNAPSHOT              (0xAAu)     /* streams the contents of every usage up the generic endpoint (or opens a restore) */
+#define CMD_USAGE_RESTORE               (0xABu)     /* one packet of a snapshot being written back - only acknowledged every n packets */
+#define CMD_CANCEL_DEFERRED             (0xACu)     /* ends a CMD_WAIT_FOR_CONDITION, CMD_REGION_CRC or CMD_BLOCK_WRITE_DATA that hasn't responded yet, acted on as it arrives */
 #define CMD_BLOCK_PRESS_REPORTS         (0xB1u)     /* enables/disables press reports */
 #define CMD_RESET_BRIDGE                (0xEFu)
 #define CMD_GET_PART_ID                 (0xF0u)     /* returns an id used by TH2 to load the correct dfu file */
@@ -122,15 +192,96 @@
 #define CMD_IIC_DATA_MASK                   (0xF8u) /* RESERVED - Used by the PB005/7 */
 #define CMD_SWITCH_MODE_DEBUG               (0xFCu) /* RESERVED - Used by the PB005/7 */
 #define CMD_SWITCH_MODE_SERIAL_DIGITIZER    (0xFDu) /* RESERVED - Used by the PB005/7 */
+#define CMD_PROXY_FLAG                      (0x9Au) /* RESERVED - byte 0 of a proxy report, never a command so a response can't be mistaken for one */
+#define CMD_PROXY_PACKED_FLAG               (0x9Bu) /* RESERVED - byte 0 of a packed proxy packet */
+#define CMD_FRAME_STREAM_FLAG               (0x9Cu) /* RESERVED - byte 0 of a streamed frame packet */
+#define CMD_FRAME_STREAM_ENCODED_FLAG       (0x9Du) /* RESERVED - byte 0 of an encoded streamed frame packet */
+#define CMD_WATCH_LIST_FLAG                 (0x9Eu) /* RESERVED - byte 0 of a watch list sample packet */
+#define CMD_USAGE_SNAPSHOT_FLAG             (0x9Fu) /* RESERVED - byte 0 of a usage snapshot packet */
+
+/*============ Local Structures ============*/
+struct commandentry_st
+{
+    uint8_t report[COMMAND_ENTRY_SIZE];
+    uint8_t interface;
+};
+
+struct waitcondition_st
+{
+    bool     boActive;
+    uint8_t  interface;         // where the response goes
+    uint16_t address;
+    uint8_t  length;            // 1, 2 or 4 bytes (little endian)
+    uint8_t  compare;           // WAIT_xxx
+    uint32_t mask;
+    uint32_t expected;
+    uint32_t value;             // last value read
+    uint16_t timeout_ms;
+    uint16_t interval_ms;
+    uint32_t start_ms;
+    uint32_t last_poll_ms;
+    uint16_t polls;
+};
+
+struct regioncrc_st
+{
+    bool     boActive;
+    uint8_t  interface;         // where the response goes
+    uint16_t address;           // next address to read
+    uint32_t remaining;
+    uint32_t length;
+    uint32_t crc;
+    bool     boCompare;
+    uint32_t expected;
+};
 
 /*============ Local Variables ============*/
+struct commandentry_st command_fifo[COMMAND_FIFO_DEPTH];
+volatile uint8_t byCommandFIFOHead  = 0;    // only written by the OUT callbacks
+volatile uint8_t byCommandFIFOTail  = 0;    // only written by the command task
+volatile bool    boGenericOutPaused = 0;    // OUT endpoint left un-armed because the FIFO was full
+volatile bool    boPressOutPaused   = 0;
+uint8_t          *pGenericOutWaiting = NULL;    // command that arrived with the FIFO already full, still sitting in the (un-armed) endpoint buffer
+uint8_t          *pPressOutWaiting   = NULL;
+volatile bool    boControlSlotReserved = 0;     // a control endpoint SET_REPORT has been accepted, its data stage hasn't arrived yet
+uint8_t          control_report[COMMAND_ENTRY_SIZE];    // SET_REPORT data stage lands here, not in the class buffer which may be holding a waiting OUT command
+bool             boCommandInProgress = 0;   // command at the tail has been run, its response hasn't gone out yet
+bool             boResponseDeferred  = 0;   // command at the tail will respond later (from the housekeeping tick), it stays at the tail until then
+volatile bool    boCancelDeferred    = 0;   // CMD_CANCEL_DEFERRED has arrived for it
+struct waitcondition_st wait_condition = {0};
+struct regioncrc_st     region_crc = {0};
+uint8_t          byBlockWriteInterface = 0;    // where the response to a CMD_BLOCK_WRITE_DATA waiting for aXiom goes
+
+// CRC32 (same as zlib/Ethernet) a nibble at a time - small enough for the F042 and still much quicker than the aXiom reads
+const uint32_t CRC32_Nibble_Table[16] = {
+    0x00000000, 0x1DB71064, 0x3B6E20C8, 0x26D930AC, 0x76DC4190, 0x6B6B51F4, 0x4DB26158, 0x5005713C,
+    0xEDB88320, 0xF00F9344, 0xD6D6A3E8, 0xCB61B38C, 0x9B64C2B0, 0x86D3D2D4, 0xA00AE278, 0xBDBDF21C
+};
 
 /*============ Exported Variables ============*/
 bool    boGenericTBPResponseWaiting = 0;
 bool    boPressTBPResponseWaiting = 0;
 uint8_t *pTBPCommandReport = 0;
+bool    boConcurrentCommands = 0;   // host has asked for commands to be run between proxy reads instead of stopping proxy
+bool    boCommandPipelining = 0;    // host has asked for sequence ids to be echoed so it can keep several commands in flight
 
 static bool UsageReadWrite_ErrorChecks(int16_t usage_table_idx, uint16_t usage_length_in_bytes);
+static void ModifyUsage(void);
+static bool CommandStopsProxy(uint8_t byCommand);
+static void RestoreProxyMode(bool boProxyMode_temp, bool boInternalProxy_temp);
+static uint8_t CommandFIFO_Count(void);
+static void CommandFIFO_Pop(void);
+static void CommandFIFO_Push(uint8_t byInterface, uint8_t *pReport);
+static void CommandFIFO_PauseOut(uint8_t byInterface, uint8_t *pWaiting);
+static bool CommandFIFO_ResumeOut(uint8_t byInterface);
+static void CommandFIFO_CheckCancel(uint8_t *pReport);
+static void AxiomBatch(void);
+static bool PollWaitCondition(void);
+static void WaitConditionResponse(uint8_t byResult);
+static void RegionCRCResponse(uint8_t byResult);
+static void SendDeferredResponse(uint8_t byInterface);
+static void DropDeferredResponse(void);
+static uint32_t ComputeCRC32(uint32_t crc, uint8_t *pData, uint16_t wdLength);
 
 /*============ Functions ============*/
 static bool UsageReadWrite_ErrorChecks(int16_t usage_table_idx, uint16_t usage_length_in_bytes)
@@ -176,6 +327,470 @@ static bool UsageReadWrite_ErrorChecks(int16_t usage_table_idx, uint16_t usage_l
     return error_check_passed;
 }
 
+/* CMD_MODIFY_USAGE - reads the field, changes the masked bits and writes it straight back, without the host in the middle
+ * uses the same byte layout and error codes as CMD_READ_USAGE/CMD_WRITE_USAGE */
+static void ModifyUsage(void)
+{
+    int16_t  usage_table_idx;
+    uint16_t address;
+    uint8_t  byWidth = pTBPCommandReport[4];
+    uint8_t  byOperation = pTBPCommandReport[13];
+    uint32_t mask = 0;
+    uint32_t value = 0;
+    uint32_t old_value = 0;
+    uint32_t new_value;
+
+    usage_table_idx = find_usage_from_table(pTBPCommandReport[1]);
+
+    if(usage_table_idx < 0)
+    {
+        /* usage number is not known to bridge */
+        pTBPCommandReport[1] = 0x96;    // error code
+        pTBPCommandReport[2] = 0x80;    // error flag
+        return;
+    }
+
+    if(((byWidth != 1) && (byWidth != 2) && (byWidth != 4)) || (byOperation > MODIFY_TOGGLE))
+    {
+        pTBPCommandReport[1] = INVALID_SETTINGS;
+        pTBPCommandReport[2] = 0x80;    // error flag
+        return;
+    }
+
+    if(UsageReadWrite_ErrorChecks(usage_table_idx, UsageLengthInBytes(usage_table_idx)) == false)
+    {
+        return;
+    }
+
+    address = UsageAddress(usage_table_idx, pTBPCommandReport[2], pTBPCommandReport[3]);
+
+    // field has to end inside the usage too, counting the start page (error checks only look at where it starts)
+    if(((uint32_t)(address - UsageAddress(usage_table_idx, 0, 0)) + byWidth) > UsageLengthInBytes(usage_table_idx))
+    {
+        pTBPCommandReport[1] = 0x92;    // too many bytes
+        pTBPCommandReport[2] = 0x80;    // error flag
+        return;
+    }
+
+    memcpy(&mask,  &pTBPCommandReport[5], byWidth);     // little endian, same as aXiom
+    memcpy(&value, &pTBPCommandReport[9], byWidth);
+
+    aXiom_Tx_Buffer[0] = (uint8_t)(address & 0xFF);
+    aXiom_Tx_Buffer[1] = (uint8_t)(address >> 8);
+    aXiom_Tx_Buffer[2] = byWidth;
+    aXiom_Tx_Buffer[3] = READ;
+    aXiom_NumBytesTx = 4;
+    aXiom_NumBytesRx = byWidth;
+
+    (void)Comms_Sequence();
+    if(aXiom_Rx_Buffer[CircularBufferHead][0] != COMMS_OK)
+    {
+        /* comms error (internal) */
+        pTBPCommandReport[1] = 0x97;    // error code
+        pTBPCommandReport[2] = 0x80;    // error flag
+        return;
+    }
+    memcpy(&old_value, &aXiom_Rx_Buffer[CircularBufferHead][2], byWidth);
+
+    new_value = (byOperation == MODIFY_TOGGLE) ? (old_value ^ mask) : ((old_value & ~mask) | (value & mask));
+
+    // nothing to write if the bits are already right
+    if(new_value != old_value)
+    {
+        aXiom_Tx_Buffer[0] = (uint8_t)(address & 0xFF);
+        aXiom_Tx_Buffer[1] = (uint8_t)(address >> 8);
+        aXiom_Tx_Buffer[2] = byWidth;
+        aXiom_Tx_Buffer[3] = WRITE;
+        memcpy(&aXiom_Tx_Buffer[4], &new_value, byWidth);
+        aXiom_NumBytesTx = 4 + byWidth;
+        aXiom_NumBytesRx = 0;
+
+        (void)Comms_Sequence();
+        if((aXiom_Rx_Buffer[CircularBufferHead][0] != COMMS_OK) && (aXiom_Rx_Buffer[CircularBufferHead][0] != COMMS_OK_NO_READ))
+        {
+            pTBPCommandReport[1] = 0x97;    // error code
+            pTBPCommandReport[2] = 0x80;    // error flag
+            return;
+        }
+    }
+
+    memcpy(&pTBPCommandReport[5], &old_value, sizeof(old_value));
+    memcpy(&pTBPCommandReport[9], &new_value, sizeof(new_value));
+}
+
+/*-----------------------------------------------------------*/
+
+static uint8_t CommandFIFO_Count(void)
+{
+    return (uint8_t)(byCommandFIFOHead - byCommandFIFOTail);
+}
+
+/*-----------------------------------------------------------*/
+
+// frees the tail entry and, if an OUT endpoint was held off because the FIFO was full, lets the host send again
+static void CommandFIFO_Pop(void)
+{
+    bool boReArmGeneric;
+    bool boReArmPress;
+
+    __disable_irq();    // the OUT callbacks also push, so a waiting command has to go in with them held off
+    byCommandFIFOTail++;
+    boReArmGeneric = CommandFIFO_ResumeOut(GENERIC_INTERFACE_NUM);
+    boReArmPress   = CommandFIFO_ResumeOut(PRESS_INTERFACE_NUM);
+    __enable_irq();
+
+    if(boReArmGeneric)
+    {
+        USBD_GENERIC_HID_ReceiveNext(&hUsbDeviceFS);
+    }
+    if(boReArmPress)
+    {
+        USBD_PRESS_HID_ReceiveNext(&hUsbDeviceFS);
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+static void CommandFIFO_Push(uint8_t byInterface, uint8_t *pReport)
+{
+    struct commandentry_st *entry;
+
+    entry = &command_fifo[byCommandFIFOHead % COMMAND_FIFO_DEPTH];
+    memcpy(entry->report, pReport, COMMAND_ENTRY_SIZE);
+    entry->interface = byInterface;
+    __DMB();    // entry must be written before the command task can see it
+    byCommandFIFOHead++;
+
+    /* temporarily stop all reports so a few proxy reports don't go out ahead of the response - only when nothing else is in the FIFO,
+     * otherwise the response to the command in front (or a deferred one being cancelled) would be held up behind this one */
+    if((byInterface == GENERIC_INTERFACE_NUM) && (CommandFIFO_Count() == 1))
+    {
+        boBlockReports = 1;
+    }
+
+    // a command queued behind a deferred one can't run until that has responded, there's no point holding proxy off until then
+    boCommandWaitingToDecode = (boResponseDeferred == 0);
+    Scheduler_PostEvent(TASK_COMMAND);
+}
+
+/*-----------------------------------------------------------*/
+
+// leaves the interface's OUT endpoint un-armed, pWaiting is a command still in its buffer that couldn't be queued yet (or NULL)
+static void CommandFIFO_PauseOut(uint8_t byInterface, uint8_t *pWaiting)
+{
+    if(byInterface == GENERIC_INTERFACE_NUM)
+    {
+        boGenericOutPaused = 1;
+        pGenericOutWaiting = pWaiting;
+    }
+    else
+    {
+        boPressOutPaused = 1;
+        pPressOutWaiting = pWaiting;
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+/* called with interrupts off once an entry has been freed - queues the command the endpoint was holding (if any)
+ * returns true if the endpoint can be re-armed */
+static bool CommandFIFO_ResumeOut(uint8_t byInterface)
+{
+    volatile bool *pboPaused   = (byInterface == GENERIC_INTERFACE_NUM) ? &boGenericOutPaused : &boPressOutPaused;
+    uint8_t      **ppWaiting   = (byInterface == GENERIC_INTERFACE_NUM) ? &pGenericOutWaiting : &pPressOutWaiting;
+    uint8_t       *pReport     = *ppWaiting;
+
+    if((*pboPaused == 0) || ((CommandFIFO_Count() + boControlSlotReserved) >= COMMAND_FIFO_DEPTH))
+    {
+        return false;
+    }
+
+    *pboPaused = 0;
+    *ppWaiting = NULL;
+
+    if(pReport != NULL)
+    {
+        return (CommandFIFO_Receive(byInterface, pReport) == USBD_OK);  // pauses the endpoint again if that's filled the FIFO
+    }
+
+    return true;
+}
+
+/*-----------------------------------------------------------*/
+
+/* CMD_CANCEL_DEFERRED can't wait its turn in the FIFO, it would only run once the command it's meant to end had finished
+ * so it's picked out as it arrives and the wait/CRC/block write ends on its next tick */
+static void CommandFIFO_CheckCancel(uint8_t *pReport)
+{
+    if((pReport[0] == CMD_CANCEL_DEFERRED) && boResponseDeferred)
+    {
+        boCancelDeferred = 1;
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+/* runs the operations in a CMD_AXIOM_BATCH command and overwrites the command with the results
+ * everything is checked before anything is sent to aXiom, so a malformed batch doesn't get half run */
+static void AxiomBatch(void)
+{
+    uint8_t results[COMMAND_ENTRY_SIZE] = {0};
+    uint8_t byPayloadEnd = (boCommandPipelining) ? COMMAND_SEQUENCE_BYTE : COMMAND_ENTRY_SIZE;
+    uint8_t byNumOps     = pTBPCommandReport[1];
+    uint8_t byOpsRun     = 0;
+    uint8_t byCmdIdx     = 2;
+    uint8_t byResultIdx  = BATCH_RESULT_HEADER_BYTES;
+    uint8_t byStatus     = PROXY_SETTINGS_OK;
+    uint8_t *op;
+    uint8_t i;
+
+    /* first pass - make sure the operations fit in the command and their results fit in the response */
+    for(i = 0; i < byNumOps; i++)
+    {
+        if((byCmdIdx + BATCH_OP_HEADER_BYTES) > byPayloadEnd)
+        {
+            byStatus = INVALID_SETTINGS;
+            break;
+        }
+
+        op = &pTBPCommandReport[byCmdIdx];
+        byCmdIdx += BATCH_OP_HEADER_BYTES;
+        byResultIdx += 1;   // status byte
+
+        if(op[2] == 0)
+        {
+            byStatus = INVALID_SETTINGS;
+            break;
+        }
+
+        if(op[3] == READ)
+        {
+            byResultIdx += op[2];
+        }
+        else
+        {
+            byCmdIdx += op[2];
+        }
+
+        if((byCmdIdx > byPayloadEnd) || (byResultIdx > byPayloadEnd))
+        {
+            byStatus = INVALID_SETTINGS;
+            break;
+        }
+    }
+
+    /* second pass - run them, stopping at the first one aXiom doesn't like */
+    if(byStatus == PROXY_SETTINGS_OK)
+    {
+        byCmdIdx    = 2;
+        byResultIdx = BATCH_RESULT_HEADER_BYTES;
+
+        for(i = 0; i < byNumOps; i++)
+        {
+            op = &pTBPCommandReport[byCmdIdx];
+            byCmdIdx += BATCH_OP_HEADER_BYTES;
+
+            memcpy(aXiom_Tx_Buffer, op, BATCH_OP_HEADER_BYTES);
+            if(op[3] == READ)
+            {
+                aXiom_NumBytesTx = BATCH_OP_HEADER_BYTES;
+                aXiom_NumBytesRx = op[2];
+            }
+            else
+            {
+                aXiom_Tx_Buffer[3] = WRITE;
+                memcpy(&aXiom_Tx_Buffer[BATCH_OP_HEADER_BYTES], &pTBPCommandReport[byCmdIdx], op[2]);
+                aXiom_NumBytesTx = BATCH_OP_HEADER_BYTES + op[2];
+                aXiom_NumBytesRx = 0;
+                byCmdIdx += op[2];
+            }
+
+            (void)Comms_Sequence();
+
+            // comms status is in the first byte of the rx buffer (COMMS_OK/COMMS_OK_NO_READ or an error)
+            results[byResultIdx++] = aXiom_Rx_Buffer[CircularBufferHead][0];
+            if((aXiom_Rx_Buffer[CircularBufferHead][0] != COMMS_OK) && (aXiom_Rx_Buffer[CircularBufferHead][0] != COMMS_OK_NO_READ))
+            {
+                break;
+            }
+
+            if(op[3] == READ)
+            {
+                memcpy(&results[byResultIdx], &aXiom_Rx_Buffer[CircularBufferHead][2], op[2]);
+                byResultIdx += op[2];
+            }
+            byOpsRun++;
+        }
+
+        // host can tell which operations never ran
+        if(byOpsRun < byNumOps)
+        {
+            memset(&results[byResultIdx], BATCH_OP_NOT_RUN, byPayloadEnd - byResultIdx);
+        }
+    }
+
+    results[0] = CMD_AXIOM_BATCH;
+    results[1] = byStatus;
+    results[2] = byOpsRun;
+    memcpy(pTBPCommandReport, results, byPayloadEnd);
+}
+
+/*-----------------------------------------------------------*/
+
+/* reads the value being waited on once, returns true (with the response filled in) if the wait is over
+ * a comms error just counts as not done yet - aXiom may well NAK while it's busy with whatever the host is waiting on */
+static bool PollWaitCondition(void)
+{
+    bool boDone;
+
+    aXiom_Tx_Buffer[0] = (uint8_t)(wait_condition.address & 0xFF);
+    aXiom_Tx_Buffer[1] = (uint8_t)(wait_condition.address >> 8);
+    aXiom_Tx_Buffer[2] = wait_condition.length;
+    aXiom_Tx_Buffer[3] = READ;
+    aXiom_NumBytesTx = 4;
+    aXiom_NumBytesRx = wait_condition.length;
+
+    (void)Comms_Sequence();
+    wait_condition.polls++;
+    wait_condition.last_poll_ms = HAL_GetTick();
+
+    if(aXiom_Rx_Buffer[CircularBufferHead][0] == COMMS_OK)
+    {
+        wait_condition.value = 0;
+        memcpy(&wait_condition.value, &aXiom_Rx_Buffer[CircularBufferHead][2], wait_condition.length);  // little endian, same as aXiom
+    }
+
+    boDone = (aXiom_Rx_Buffer[CircularBufferHead][0] == COMMS_OK) &&
+             ((wait_condition.compare == WAIT_EQUAL) ? ((wait_condition.value & wait_condition.mask) == wait_condition.expected) :
+                                                      ((wait_condition.value & wait_condition.mask) != wait_condition.expected));
+
+    if(boDone || ((wait_condition.last_poll_ms - wait_condition.start_ms) >= wait_condition.timeout_ms))
+    {
+        WaitConditionResponse((boDone) ? WAIT_CONDITION_MET : WAIT_TIMED_OUT);
+        return true;
+    }
+
+    return false;
+}
+
+/*-----------------------------------------------------------*/
+
+// fills in the CMD_WAIT_FOR_CONDITION response and ends the wait
+static void WaitConditionResponse(uint8_t byResult)
+{
+    uint32_t elapsed_ms = HAL_GetTick() - wait_condition.start_ms;
+
+    pTBPCommandReport[1] = byResult;
+    memcpy(&pTBPCommandReport[2], &wait_condition.value, sizeof(wait_condition.value));
+    pTBPCommandReport[6] = (uint8_t)(elapsed_ms & 0xFF);
+    pTBPCommandReport[7] = (uint8_t)((elapsed_ms > 0xFFFF) ? 0xFF : (elapsed_ms >> 8));
+    pTBPCommandReport[8] = (uint8_t)(wait_condition.polls & 0xFF);
+    pTBPCommandReport[9] = (uint8_t)(wait_condition.polls >> 8);
+    wait_condition.boActive = false;
+}
+
+/*-----------------------------------------------------------*/
+
+// a deferred response (CMD_WAIT_FOR_CONDITION, CMD_REGION_CRC, CMD_BLOCK_WRITE_DATA) is ready, it goes out like any other and frees the FIFO entry once sent
+static void SendDeferredResponse(uint8_t byInterface)
+{
+    boResponseDeferred = 0;
+    boCancelDeferred   = 0;
+    boBlockReports     = 0;
+    boCommandWaitingToDecode = (CommandFIFO_Count() > 1);   // anything queued behind it is next in line now
+    if(byInterface == GENERIC_INTERFACE_NUM)
+    {
+        boGenericTBPResponseWaiting = 1;
+    }
+    else
+    {
+        boPressTBPResponseWaiting = 1;
+    }
+    Scheduler_PostEvent(TASK_USB_IN);
+}
+
+/*-----------------------------------------------------------*/
+
+// a deferred command finished without anything to say (e.g. a CMD_BLOCK_WRITE_DATA mid-window), the FIFO entry is freed as if a response had gone
+static void DropDeferredResponse(void)
+{
+    boResponseDeferred = 0;
+    boCancelDeferred   = 0;
+    CommandFIFO_ResponseSent();
+}
+
+/*-----------------------------------------------------------*/
+
+// fills in the CMD_REGION_CRC response, ends the CRC and sends the response
+static void RegionCRCResponse(uint8_t byResult)
+{
+    uint32_t crc = ~region_crc.crc;
+    uint32_t bytes_read = region_crc.length - region_crc.remaining;
+
+    pTBPCommandReport[1] = byResult;
+    memcpy(&pTBPCommandReport[2], &crc, sizeof(crc));
+    memcpy(&pTBPCommandReport[6], &bytes_read, sizeof(bytes_read));
+
+    region_crc.boActive = false;
+    SendDeferredResponse(region_crc.interface);
+}
+
+/*-----------------------------------------------------------*/
+
+// pass in 0xFFFFFFFF to start, the result has to be inverted at the end
+static uint32_t ComputeCRC32(uint32_t crc, uint8_t *pData, uint16_t wdLength)
+{
+    while(wdLength--)
+    {
+        crc ^= *pData++;
+        crc = (crc >> 4) ^ CRC32_Nibble_Table[crc & 0x0F];
+        crc = (crc >> 4) ^ CRC32_Nibble_Table[crc & 0x0F];
+    }
+
+    return crc;
+}
+
+/*-----------------------------------------------------------*/
+
+// commands that still stop proxy when running concurrently - they're either how the host ends streaming or need aXiom to themselves
+static bool CommandStopsProxy(uint8_t byCommand)
+{
+    bool status = false;
+
+    switch(byCommand)
+    {
+        case CMD_ZERO:
+        case CMD_NULL:
+        case CMD_MULTIPAGE_READ:    // sets up aXiom_Tx_Buffer across several reads, a proxy read in between would trample it
+        case CMD_FW_UPDATE_OPEN:    // aXiom is about to be in its bootloader, there won't be any reports to read
+        {
+            status = true;
+            break;
+        }
+        default:
+        {
+            status = false;
+            break;
+        }
+    }
+
+    return status;
+}
+
+// puts proxy back the way it was before the command, the nIRQ pin was de-initialised if the command stopped proxy so it's set up again
+static void RestoreProxyMode(bool boProxyMode_temp, bool boInternalProxy_temp)
+{
+    boProxyEnabled = boProxyMode_temp;
+    boInternalProxy = boInternalProxy_temp;
+
+    if((boProxyEnabled == 1) || (boInternalProxy == 1))
+    {
+        InitProxyInterruptMode();
+    }
+}
+
+/*-----------------------------------------------------------*/
+
 void ProcessTBPCommand()
 {
     bool boProxyMode_temp;
@@ -188,7 +803,17 @@ void ProcessTBPCommand()
     if(target_interface == GENERIC_INTERFACE_NUM)
     {
         pTBPCommandReport = pTBPCommandReportGeneric;
+    }
+    else if(target_interface == PRESS_INTERFACE_NUM)
+    {
+        pTBPCommandReport = pTBPCommandReportPress;
+    }
 
+    /* in concurrent mode the command is simply run between two proxy reads - touch input carries on and the response is interleaved with the
+     * proxy packets on the generic endpoint. Proxy packets always start with PROXY_FLAG/PROXY_PACKED_FLAG, which are never used as commands,
+     * so byte 0 tells the host which is which */
+    if((target_interface == GENERIC_INTERFACE_NUM) && ((boConcurrentCommands == 0) || CommandStopsProxy(pTBPCommandReport[0])))
+    {
         // clear all proxy flags --> makes sure the process doesn't start halfway through next time
         boInternalProxy = 0;
         boProxyReportAvailable = 0;
@@ -199,10 +824,6 @@ void ProcessTBPCommand()
         // de-init proxy gpio pin
         DeInitProxyInterruptMode();
     }
-    else if(target_interface == PRESS_INTERFACE_NUM)
-    {
-        pTBPCommandReport = pTBPCommandReportPress;
-    }
 
     switch (pTBPCommandReport[0])
     {
@@ -222,53 +843,601 @@ void ProcessTBPCommand()
                 }
                 else
                 {
-                    // Address is stored in i2c format (i.e. lsb is the RW bit)
-                    pTBPCommandReport[1] = device_address >> 1U;
+                    // Address is stored in i2c format (i.e. lsb is the RW bit)
+                    pTBPCommandReport[1] = device_address >> 1U;
+                }
+            }
+            else
+            {
+                // error
+                pTBPCommandReport[1] = I2C_ERROR;
+            }
+
+            break;
+        }
+//-------
+        case CMD_RESET_AXIOM: //0x99
+        {
+            HAL_GPIO_WritePin(nRESET_GPIO_Port, nRESET, RESET);
+            HAL_Delay(1);
+            HAL_GPIO_WritePin(nRESET_GPIO_Port, nRESET, SET);
+            HAL_Delay(500); // gives aXiom time to boot up again before having anything requested of it
+            Script_Event(SCRIPT_EVENT_AXIOM_RESET);
+            RestoreProxyMode(boProxyMode_temp, boInternalProxy_temp);
+            break;
+        }
+//-------
+        case CMD_ZERO:  //0x00  /* TH2 will call this as it exits - stops proxy mode, starts counter to re-enable proxy mode once it has closed */
+        {
+            boUSBTimeoutEnabled = true;
+            // set both LEDs ON
+            HAL_GPIO_WritePin(LED_AXIOM_GPIO_Port, LED_AXIOM_Pin, SET);
+            HAL_GPIO_WritePin(LED_USB_GPIO_Port, LED_USB_Pin, SET);
+            break;
+        }
+//-------
+        case CMD_AXIOM_COMMS: //0x51 /* used by TH2 to learn about the bridge, and read/write usages */
+        {
+            /* copy the no. bytes to write/read from aXiom */
+            aXiom_NumBytesTx = pTBPCommandReport[1];
+            aXiom_NumBytesRx = pTBPCommandReport[2];
+
+            /* Copy data to transmit to aXiom, starting from 4th byte in USB input buffer (from host) and copying for SPI_NumBytesTx */
+            memcpy(aXiom_Tx_Buffer, &pTBPCommandReport[3], aXiom_NumBytesTx);
+
+            // don't need to react to status as they are sent to host in response packet
+            (void)Comms_Sequence();
+
+            // want a response immediately, so set up to send at end of this function
+            memcpy(pTBPCommandReport, aXiom_Rx_Buffer[CircularBufferHead], USBD_GENERIC_HID_REPORT_IN_SIZE);
+            break;
+        }
+//-------
+        case CMD_AXIOM_BATCH: //0x91
+        {
+            /* Command bytes
+             * 1: no. operations
+             * 2+: operations, back to back, each one:
+             *     0-1: aXiom address (lo, hi)
+             *     2:   no. bytes (1+)
+             *     3:   0x80 = read, anything else = write
+             *     4+:  data to write (writes only)
+             *
+             * RETURN
+             * 1: PROXY_SETTINGS_OK, or INVALID_SETTINGS if the operations (or their results) don't fit in a report - nothing is run
+             * 2: no. operations that completed
+             * 3+: for each operation that was attempted, its comms status followed by the data read (reads only)
+             *     an operation that fails stops the batch, the rest of the report is then filled with 0xFF
+             */
+            AxiomBatch();
+            break;
+        }
+//-------
+        case CMD_BLOCK_WRITE_OPEN: //0x92
+        {
+            /* Command bytes
+             * 1-2: aXiom start address (lo, hi)
+             * 3-4: total no. bytes to write (lo, hi) - 0 closes any open session
+             * 5:   no. data packets per acknowledgement (0 is treated as 1)
+             *
+             * RETURN
+             * 1: status (BLOCK_WRITE_OK or BLOCK_WRITE_INVALID)
+             * 2: max. no. data bytes per CMD_BLOCK_WRITE_DATA packet
+             */
+            pTBPCommandReport[1] = BlockWrite_Open(((uint16_t)pTBPCommandReport[2] << 8) | pTBPCommandReport[1],
+                                                   ((uint16_t)pTBPCommandReport[4] << 8) | pTBPCommandReport[3],
+                                                   pTBPCommandReport[5]);
+            pTBPCommandReport[2] = ((boCommandPipelining) ? COMMAND_SEQUENCE_BYTE : COMMAND_ENTRY_SIZE) - BLOCK_WRITE_DATA_OFFSET;
+            break;
+        }
+//-------
+        case CMD_BLOCK_WRITE_DATA: //0x93
+        {
+            /* Command bytes
+             * 1: sequence no. (0 for the first packet after opening, wraps at 255)
+             * 2: no. data bytes in this packet
+             * 3+: data - written to aXiom at the session address, page crossings are split up by the bridge
+             *
+             * in a passthrough session, a packet that arrives while aXiom is still busy with the last one is held (at the head of the
+             * command queue) and polled from the housekeeping tick rather than the bridge waiting here - CMD_CANCEL_DEFERRED gives up on it
+             *
+             * RETURN (only after every n packets, the last packet, or an error - the host doesn't wait for anything else)
+             * 1: status (BLOCK_WRITE_xxx), anything other than BLOCK_WRITE_OK closes the session
+             * 2: sequence no. of the last packet written
+             * 3-4: total bytes written (lo, hi)
+             * 5-6: bytes still to come (lo, hi)
+             */
+            boRespondNow = BlockWrite_Data(pTBPCommandReport, (boCommandPipelining) ? COMMAND_SEQUENCE_BYTE : COMMAND_ENTRY_SIZE);
+            if(BlockWrite_PacketWaiting())
+            {
+                byBlockWriteInterface = target_interface;
+                boCancelDeferred   = 0;
+                boResponseDeferred = 1;
+            }
+            break;
+        }
+//-------
+        case CMD_FW_UPDATE_OPEN: //0x94
+        {
+            /* Command bytes
+             * 1-2: address of aXiom's bootloader status byte (lo, hi)
+             * 3:   status mask
+             * 4:   status value (after masking) that means aXiom is ready for the next chunk
+             * 5-6: how long to wait for aXiom to be ready before giving up, in ms (lo, hi) - 0 = 1s
+             * 7:   no. data packets per acknowledgement (0 is treated as 1)
+             * 8:   ms between status reads while aXiom is busy (0 = 1ms)
+             *
+             * each CMD_BLOCK_WRITE_DATA packet is then sent to aXiom as it is (header included, like CMD_AXIOM_COMMS), the bridge
+             * polls the status byte itself before sending the next one. An empty data packet ends the update once aXiom is ready.
+             * Proxy is stopped (even with concurrent commands) as aXiom won't be producing reports
+             *
+             * RETURN
+             * 1: status (BLOCK_WRITE_OK or BLOCK_WRITE_INVALID)
+             * 2: max. no. bytes per CMD_BLOCK_WRITE_DATA packet
+             */
+            pTBPCommandReport[1] = BlockWrite_OpenPassthrough(((uint16_t)pTBPCommandReport[2] << 8) | pTBPCommandReport[1],
+                                                              pTBPCommandReport[3],
+                                                              pTBPCommandReport[4],
+                                                              ((uint16_t)pTBPCommandReport[6] << 8) | pTBPCommandReport[5],
+                                                              pTBPCommandReport[8],
+                                                              pTBPCommandReport[7]);
+            pTBPCommandReport[2] = ((boCommandPipelining) ? COMMAND_SEQUENCE_BYTE : COMMAND_ENTRY_SIZE) - BLOCK_WRITE_DATA_OFFSET;
+            break;
+        }
+//-------
+        case CMD_FRAME_STREAM: //0x95
+        {
+            /* Command bytes
+             * 1:   trigger - 0 = stop, 1 = every report read off aXiom, 2 = every n reports, 3 = every n ms
+             *      (report triggers need proxy, host or internal, to be running)
+             * 2-3: start address of the region (lo, hi)
+             * 4-5: no. bytes per frame (lo, hi)
+             * 6:   page length (0 = 256), same as CMD_MULTIPAGE_READ
+             * 7-8: n (lo, hi)
+             *
+             * frames are then sent up the generic endpoint without the host asking, each packet starts with CMD_FRAME_STREAM_FLAG and
+             * carries the frame no. and the data's offset into the frame (see Frame_Stream.h)
+             *
+             * RETURN
+             * 1:   PROXY_SETTINGS_OK or INVALID_SETTINGS
+             * 2:   max. no. data bytes per packet
+             * 3-4: frames skipped since the stream was started (lo, hi) - when stopping, for the stream that's just stopped
+             */
+            if(pTBPCommandReport[1] == FRAME_TRIGGER_OFF)
+            {
+                FrameStream_Stop();
+                pTBPCommandReport[1] = PROXY_SETTINGS_OK;
+            }
+            else if(FrameStream_Start(pTBPCommandReport[1],
+                                      ((uint16_t)pTBPCommandReport[3] << 8) | pTBPCommandReport[2],
+                                      ((uint16_t)pTBPCommandReport[5] << 8) | pTBPCommandReport[4],
+                                      pTBPCommandReport[6],
+                                      ((uint16_t)pTBPCommandReport[8] << 8) | pTBPCommandReport[7]))
+            {
+                pTBPCommandReport[1] = PROXY_SETTINGS_OK;
+            }
+            else
+            {
+                pTBPCommandReport[1] = INVALID_SETTINGS;
+            }
+            pTBPCommandReport[2] = FRAME_STREAM_MAX_DATA;
+            pTBPCommandReport[3] = (uint8_t)(FrameStream_GetSkipped() & 0xFF);
+            pTBPCommandReport[4] = (uint8_t)(FrameStream_GetSkipped() >> 8);
+
+            RestoreProxyMode(boProxyMode_temp, boInternalProxy_temp);
+            break;
+        }
+//-------
+        case CMD_FRAME_STREAM_ENCODING: //0x96
+        {
+            /* Command bytes
+             * 1: 0 = raw, 1 = each frame XORed against the previous one then run-length encoded (see Frame_Stream.h)
+             * 2: key frame interval - a frame that doesn't depend on the previous one is sent at least every n frames (0 = 16)
+             *
+             * RETURN
+             * 1:   PROXY_SETTINGS_OK, or INVALID_SETTINGS if the frame being streamed is too big to encode
+             * 2-3: largest frame that can be encoded (lo, hi)
+             */
+            pTBPCommandReport[1] = FrameStream_SetEncoding(pTBPCommandReport[1], pTBPCommandReport[2]) ? PROXY_SETTINGS_OK : INVALID_SETTINGS;
+            pTBPCommandReport[2] = (uint8_t)(MAX_ENCODED_FRAME_BYTES & 0xFF);
+            pTBPCommandReport[3] = (uint8_t)(MAX_ENCODED_FRAME_BYTES >> 8);
+
+            RestoreProxyMode(boProxyMode_temp, boInternalProxy_temp);
+            break;
+        }
+//-------
+        case CMD_WATCH_LIST_ENTRY: //0x97
+        case CMD_WATCH_LIST_START: //0x98
+        {
+            /* WATCH LIST ENTRY
+             * Command bytes
+             * 1:   entry index (0 to MAX_WATCH_ENTRIES - 1)
+             * 2-3: aXiom address (lo, hi)
+             * 4:   no. bytes (0 removes the entry, max. MAX_WATCH_BYTES)
+             * 5:   flags - bit 0 set = only send the entry when its bytes change
+             *
+             * WATCH LIST START
+             * 1:   trigger - 0 = stop, 1 = every report read off aXiom (needs proxy running), 2 = every n ms
+             * 2-3: n (lo, hi)
+             *
+             * samples are then sent up the generic endpoint without the host asking, each packet starts with CMD_WATCH_LIST_FLAG
+             * (see Watch_List.h)
+             *
+             * RETURN
+             * 1:   PROXY_SETTINGS_OK or INVALID_SETTINGS
+             * 2:   MAX_WATCH_ENTRIES
+             * 3:   MAX_WATCH_BYTES
+             * 4-5: samples skipped since sampling was started (lo, hi) - when stopping, for the run that's just stopped
+             */
+            bool boValid;
+
+            if(pTBPCommandReport[0] == CMD_WATCH_LIST_ENTRY)
+            {
+                boValid = WatchList_SetEntry(pTBPCommandReport[1], ((uint16_t)pTBPCommandReport[3] << 8) | pTBPCommandReport[2],
+                                             pTBPCommandReport[4], pTBPCommandReport[5]);
+            }
+            else
+            {
+                boValid = WatchList_Start(pTBPCommandReport[1], ((uint16_t)pTBPCommandReport[3] << 8) | pTBPCommandReport[2]);
+            }
+
+            pTBPCommandReport[1] = (boValid) ? PROXY_SETTINGS_OK : INVALID_SETTINGS;
+            pTBPCommandReport[2] = MAX_WATCH_ENTRIES;
+            pTBPCommandReport[3] = MAX_WATCH_BYTES;
+            pTBPCommandReport[4] = (uint8_t)(WatchList_GetSkipped() & 0xFF);
+            pTBPCommandReport[5] = (uint8_t)(WatchList_GetSkipped() >> 8);
+
+            RestoreProxyMode(boProxyMode_temp, boInternalProxy_temp);
+            break;
+        }
+//-------
+        case CMD_WAIT_FOR_CONDITION: //0xA4
+        {
+            /* Command bytes
+             * 1-2:   aXiom address (lo, hi)
+             * 3:     no. bytes to read - 1, 2 or 4 (value, mask and expected are little endian, like aXiom)
+             * 4:     0 = done when (value & mask) == expected, 1 = done when (value & mask) != expected
+             * 5-8:   mask
+             * 9-12:  expected
+             * 13-14: timeout in ms (lo, hi)
+             * 15:    ms between reads (0 = as often as possible, i.e. every 1ms)
+             *
+             * the bridge reads the address itself and doesn't respond until the condition is met or the timeout runs out - commands
+             * sent in the meantime are queued behind this one (CMD_CANCEL_DEFERRED excepted). Proxy is left as it was, so touch reports
+             * carry on while waiting, queued commands included
+             *
+             * RETURN
+             * 1:   WAIT_CONDITION_MET, WAIT_TIMED_OUT, WAIT_CANCELLED or INVALID_SETTINGS
+             * 2-5: last value read
+             * 6-7: ms taken (lo, hi)
+             * 8-9: no. reads (lo, hi)
+             */
+            uint8_t byLength = pTBPCommandReport[3];
+
+            if(((byLength != 1) && (byLength != 2) && (byLength != 4)) || (pTBPCommandReport[4] > WAIT_NOT_EQUAL))
+            {
+                pTBPCommandReport[1] = INVALID_SETTINGS;
+            }
+            else
+            {
+                memset(&wait_condition, 0, sizeof(wait_condition));
+                wait_condition.interface   = target_interface;
+                wait_condition.address     = ((uint16_t)pTBPCommandReport[2] << 8) | pTBPCommandReport[1];
+                wait_condition.length      = byLength;
+                wait_condition.compare     = pTBPCommandReport[4];
+                memcpy(&wait_condition.mask,     &pTBPCommandReport[5], sizeof(wait_condition.mask));
+                memcpy(&wait_condition.expected, &pTBPCommandReport[9], sizeof(wait_condition.expected));
+                wait_condition.timeout_ms  = ((uint16_t)pTBPCommandReport[14] << 8) | pTBPCommandReport[13];
+                wait_condition.interval_ms = pTBPCommandReport[15];
+                wait_condition.start_ms    = HAL_GetTick();
+                wait_condition.boActive    = true;
+                boCancelDeferred = 0;
+
+                // often already true, in which case there's no need to wait for the tick
+                if(PollWaitCondition() == false)
+                {
+                    boRespondNow = 0;
+                    boResponseDeferred = 1;
+                }
+            }
+
+            RestoreProxyMode(boProxyMode_temp, boInternalProxy_temp);
+            break;
+        }
+//-------
+        case CMD_REGION_CRC: //0xA5
+        {
+            /* Command bytes
+             * 1-2: aXiom start address (lo, hi)
+             * 3-5: no. bytes (lo, mid, hi) - the range can't run past 0xFFFF
+             * 6:   bit 0 set = compare against the CRC in bytes 7-10
+             * 7-10: expected CRC32 (lo first)
+             *
+             * the range is read on the bridge as fast as aXiom allows (whenever nothing else needs the main loop) and the response is sent
+             * once it has all been read - commands sent in the meantime are queued behind this one (CMD_CANCEL_DEFERRED excepted), proxy
+             * carries on as normal
+             * CRC32 is the usual zlib/Ethernet one (reflected 0x04C11DB7, start 0xFFFFFFFF, inverted at the end)
+             *
+             * RETURN
+             * 1:    CRC_MATCH (or done, if not comparing), CRC_MISMATCH, CRC_COMMS_ERROR, CRC_CANCELLED or INVALID_SETTINGS
+             * 2-5:  CRC32 of the bytes read (lo first)
+             * 6-9:  no. bytes read (lo first) - short of the length if a read failed
+             */
+            uint32_t length = (uint32_t)pTBPCommandReport[3] | ((uint32_t)pTBPCommandReport[4] << 8) | ((uint32_t)pTBPCommandReport[5] << 16);
+            uint16_t start  = ((uint16_t)pTBPCommandReport[2] << 8) | pTBPCommandReport[1];
+
+            if((length == 0) || ((start + length) > 0x10000UL))
+            {
+                pTBPCommandReport[1] = INVALID_SETTINGS;
+            }
+            else
+            {
+                memset(&region_crc, 0, sizeof(region_crc));
+                region_crc.interface = target_interface;
+                region_crc.address   = start;
+                region_crc.length    = length;
+                region_crc.remaining = length;
+                region_crc.crc       = 0xFFFFFFFFUL;
+                region_crc.boCompare = ((pTBPCommandReport[6] & CRC_COMPARE) != 0);
+                memcpy(&region_crc.expected, &pTBPCommandReport[7], sizeof(region_crc.expected));
+                region_crc.boActive  = true;
+                boCancelDeferred = 0;
+
+                boRespondNow = 0;
+                boResponseDeferred = 1;
+                Scheduler_PostEvent(TASK_BLOCK_READ);
+            }
+
+            RestoreProxyMode(boProxyMode_temp, boInternalProxy_temp);
+            break;
+        }
+//-------
+        case CMD_MODIFY_USAGE: //0xA6
+        {
+            /* Command bytes
+             * 1:     usage number
+             * 2:     relative start page (0 means 1st page)
+             * 3:     byte offset into page
+             * 4:     field width in bytes - 1, 2 or 4 (mask/value are little endian, like aXiom)
+             * 5-8:   mask - only these bits are changed
+             * 9-12:  value (MODIFY_REPLACE only)
+             * 13:    MODIFY_REPLACE = masked bits set to value, MODIFY_TOGGLE = masked bits flipped
+             *
+             * the field is read, modified and written back by the bridge in one go (not written at all if nothing changes)
+             *
+             * RETURN
+             * 1-4:   echo command (or error code in 1 and 0x80 in 2, same as CMD_WRITE_USAGE)
+             * 5-8:   value before
+             * 9-12:  value after
+             */
+            ModifyUsage();
+            break;
+        }
+//-------
+        case CMD_SCRIPT_LOAD: //0xA7
+        {
+            /* Command bytes
+             * 1-2: offset into the script (lo, hi) - pieces have to be sent in order, 0 starts a new script
+             * 3:   no. bytes in this piece
+             * 4+:  script bytes (see Script_Engine.h for the instructions)
+             *
+             * RETURN
+             * 1:   SCRIPT_OK, SCRIPT_INVALID (out of order or too long) or SCRIPT_BUSY (script running)
+             * 2-3: no. bytes loaded so far (lo, hi)
+             */
+            uint8_t byPayloadEnd = (boCommandPipelining) ? COMMAND_SEQUENCE_BYTE : COMMAND_ENTRY_SIZE;
+
+            if(pTBPCommandReport[3] > (byPayloadEnd - SCRIPT_LOAD_HEADER_BYTES))
+            {
+                pTBPCommandReport[1] = SCRIPT_INVALID;
+            }
+            else
+            {
+                pTBPCommandReport[1] = Script_Load(((uint16_t)pTBPCommandReport[2] << 8) | pTBPCommandReport[1],
+                                                   &pTBPCommandReport[SCRIPT_LOAD_HEADER_BYTES], pTBPCommandReport[3]);
+            }
+            pTBPCommandReport[2] = (uint8_t)(Script_GetLength() & 0xFF);
+            pTBPCommandReport[3] = (uint8_t)(Script_GetLength() >> 8);
+
+            RestoreProxyMode(boProxyMode_temp, boInternalProxy_temp);
+            break;
+        }
+//-------
+        case CMD_SCRIPT_CONTROL: //0xA8
+        {
+            /* Command bytes
+             * 1: action - 0 = status only, 1 = run, 2 = stop, 3 = set events, 4 = save script and events to flash, 5 = erase the saved copy
+             * 2: events that start the script (set events) - bit 0 = boot, bit 1 = CMD_RESET_AXIOM, bit 2 = aXiom comms error
+             *
+             * the script runs between proxy reads and commands, one instruction at a time, so touch reports carry on while it runs.
+             * Saving stalls the bridge for the flash erase (~40ms) and isn't supported on the F042
+             *
+             * RETURN
+             * 1:     SCRIPT_OK, SCRIPT_INVALID, SCRIPT_BUSY or SCRIPT_FLASH_ERROR
+             * 2:     state - 0 = idle, 1 = running, 2 = done, 3 = failed
+             * 3-4:   offset of the instruction running (or that failed)
+             * 5:     error (SCRIPT_ERR_xxx, or the code from a FAIL instruction)
+             * 6:     what started the last run (0 = host, otherwise the event bit)
+             * 7:     events that start the script
+             * 8-9:   script length
+             * 10-11: no. result bytes
+             * 12:    1 if there's a script saved in flash
+             * 13-14: SCRIPT_MAX_BYTES
+             * 15-16: SCRIPT_MAX_RESULTS
+             */
+            uint8_t byStatus = SCRIPT_OK;
+
+            switch(pTBPCommandReport[1])
+            {
+                case SCRIPT_ACTION_STATUS:
+                {
+                    break;
+                }
+                case SCRIPT_ACTION_RUN:
+                {
+                    byStatus = Script_Run(SCRIPT_EVENT_HOST);
+                    break;
+                }
+                case SCRIPT_ACTION_STOP:
+                {
+                    Script_Stop();
+                    break;
+                }
+                case SCRIPT_ACTION_SET_EVENTS:
+                {
+                    byStatus = Script_SetEventMask(pTBPCommandReport[2]);
+                    break;
+                }
+                case SCRIPT_ACTION_SAVE:
+                {
+                    byStatus = Script_Save();
+                    break;
+                }
+                case SCRIPT_ACTION_ERASE_SAVED:
+                {
+                    byStatus = Script_EraseSaved();
+                    break;
+                }
+                default:
+                {
+                    byStatus = SCRIPT_INVALID;
+                    break;
+                }
+            }
+
+            pTBPCommandReport[1]  = byStatus;
+            pTBPCommandReport[2]  = Script_GetState();
+            pTBPCommandReport[3]  = (uint8_t)(Script_GetPC() & 0xFF);
+            pTBPCommandReport[4]  = (uint8_t)(Script_GetPC() >> 8);
+            pTBPCommandReport[5]  = Script_GetError();
+            pTBPCommandReport[6]  = Script_GetLastEvent();
+            pTBPCommandReport[7]  = Script_GetEventMask();
+            pTBPCommandReport[8]  = (uint8_t)(Script_GetLength() & 0xFF);
+            pTBPCommandReport[9]  = (uint8_t)(Script_GetLength() >> 8);
+            pTBPCommandReport[10] = (uint8_t)(Script_GetResultLength() & 0xFF);
+            pTBPCommandReport[11] = (uint8_t)(Script_GetResultLength() >> 8);
+            pTBPCommandReport[12] = (Script_IsSaved()) ? 1 : 0;
+            pTBPCommandReport[13] = (uint8_t)(SCRIPT_MAX_BYTES & 0xFF);
+            pTBPCommandReport[14] = (uint8_t)(SCRIPT_MAX_BYTES >> 8);
+            pTBPCommandReport[15] = (uint8_t)(SCRIPT_MAX_RESULTS & 0xFF);
+            pTBPCommandReport[16] = (uint8_t)(SCRIPT_MAX_RESULTS >> 8);
+
+            RestoreProxyMode(boProxyMode_temp, boInternalProxy_temp);
+            break;
+        }
+//-------
+        case CMD_SCRIPT_RESULTS: //0xA9
+        {
+            /* Command bytes
+             * 1-2: offset into the results (lo, hi)
+             *
+             * results are the bytes from each READ and MARK, in the order they ran - cleared when the script is (re)started
+             *
+             * RETURN
+             * 1:   PROXY_SETTINGS_OK, or INVALID_SETTINGS if the offset is past the end
+             * 2:   state (as CMD_SCRIPT_CONTROL) - the results can be read while it's still running
+             * 3-4: total no. result bytes (lo, hi)
+             * 5:   no. bytes in this response
+             * 6+:  result bytes
+             */
+            uint8_t  byPayloadEnd = (boCommandPipelining) ? COMMAND_SEQUENCE_BYTE : COMMAND_ENTRY_SIZE;
+            uint16_t wdOffset     = ((uint16_t)pTBPCommandReport[2] << 8) | pTBPCommandReport[1];
+            uint8_t  byCount;
+
+            byCount = Script_ReadResults(wdOffset, &pTBPCommandReport[SCRIPT_RESULTS_HEADER_BYTES], byPayloadEnd - SCRIPT_RESULTS_HEADER_BYTES);
+
+            pTBPCommandReport[1] = (wdOffset > Script_GetResultLength()) ? INVALID_SETTINGS : PROXY_SETTINGS_OK;
+            pTBPCommandReport[2] = Script_GetState();
+            pTBPCommandReport[3] = (uint8_t)(Script_GetResultLength() & 0xFF);
+            pTBPCommandReport[4] = (uint8_t)(Script_GetResultLength() >> 8);
+            pTBPCommandReport[5] = byCount;
+
+            RestoreProxyMode(boProxyMode_temp, boInternalProxy_temp);
+            break;
+        }
+//-------
+        case CMD_USAGE_SNAPSHOT: //0xAA
+        {
+            /* Command bytes
+             * 1: 0 = stop a snapshot (and close any restore), 1 = start a snapshot, 2 = open a restore
+             *
+             * a snapshot is then sent up the generic endpoint without the host asking, each packet starts with CMD_USAGE_SNAPSHOT_FLAG
+             * (see Usage_Snapshot.h). To restore, open a restore and send the same packets back in order as CMD_USAGE_RESTORE - the read
+             * only usages (u31-u33) and the system manager command usage (u02) are in the snapshot but aren't written back
+             *
+             * RETURN
+             * 1:   PROXY_SETTINGS_OK, or INVALID_SETTINGS (unknown action, or no usage table - aXiom not there)
+             * 2:   no. usages a snapshot sends
+             * 3-6: no. data bytes a snapshot sends (lo first)
+             * 7:   USAGE_RESTORE_WINDOW - restore packets per acknowledgement
+             */
+            uint32_t total_bytes;
+            bool     boValid = true;
+
+            switch(pTBPCommandReport[1])
+            {
+                case SNAPSHOT_ACTION_STOP:
+                {
+                    UsageSnapshot_Stop();
+                    UsageRestore_Close();
+                    break;
+                }
+                case SNAPSHOT_ACTION_START:
+                {
+                    boValid = UsageSnapshot_Start();
+                    break;
+                }
+                case SNAPSHOT_ACTION_OPEN_RESTORE:
+                {
+                    UsageRestore_Open();
+                    break;
+                }
+                default:
+                {
+                    boValid = false;
+                    break;
                 }
             }
-            else
-            {
-                // error
-                pTBPCommandReport[1] = I2C_ERROR;
-            }
 
+            pTBPCommandReport[1] = (boValid) ? PROXY_SETTINGS_OK : INVALID_SETTINGS;
+            pTBPCommandReport[2] = UsageSnapshot_CountUsages(&total_bytes);
+            memcpy(&pTBPCommandReport[3], &total_bytes, sizeof(total_bytes));
+            pTBPCommandReport[7] = USAGE_RESTORE_WINDOW;
+
+            RestoreProxyMode(boProxyMode_temp, boInternalProxy_temp);
             break;
         }
 //-------
-        case CMD_RESET_AXIOM: //0x99
-        {
-            HAL_GPIO_WritePin(nRESET_GPIO_Port, nRESET, RESET);
-            HAL_Delay(1);
-            HAL_GPIO_WritePin(nRESET_GPIO_Port, nRESET, SET);
-            HAL_Delay(500); // gives aXiom time to boot up again before having anything requested of it
-            boProxyEnabled = boProxyMode_temp;  // reinstate previous proxy mode
-            boInternalProxy = boInternalProxy_temp; // restore the mode proxy was in before function was called
-            break;
-        }
-//-------
-        case CMD_ZERO:  //0x00  /* TH2 will call this as it exits - stops proxy mode, starts counter to re-enable proxy mode once it has closed */
+        case CMD_USAGE_RESTORE: //0xAB
         {
-            boUSBTimeoutEnabled = true;
-            // set both LEDs ON
-            HAL_GPIO_WritePin(LED_AXIOM_GPIO_Port, LED_AXIOM_Pin, SET);
-            HAL_GPIO_WritePin(LED_USB_GPIO_Port, LED_USB_Pin, SET);
+            /* Command bytes
+             * 1+: a snapshot packet as it was sent (status, sequence no., usage, revision, offset, no. bytes, data)
+             *
+             * RETURN (only after every USAGE_RESTORE_WINDOW packets, the end packet, or an error - the host doesn't wait for anything else)
+             * 1:   status (USAGE_RESTORE_xxx), anything other than USAGE_RESTORE_OK closes the restore
+             * 2:   sequence no. of the last packet written
+             * 3:   usage no. of the last packet written
+             * 4-7: total data bytes written (lo first) - not counting the usages a restore skips (read only u31-u33, command usage u02)
+             */
+            boRespondNow = UsageRestore_Data(pTBPCommandReport, (boCommandPipelining) ? COMMAND_SEQUENCE_BYTE : COMMAND_ENTRY_SIZE);
             break;
         }
 //-------
-        case CMD_AXIOM_COMMS: //0x51 /* used by TH2 to learn about the bridge, and read/write usages */
+        case CMD_CANCEL_DEFERRED: //0xAC
         {
-            /* copy the no. bytes to write/read from aXiom */
-            aXiom_NumBytesTx = pTBPCommandReport[1];
-            aXiom_NumBytesRx = pTBPCommandReport[2];
-
-            /* Copy data to transmit to aXiom, starting from 4th byte in USB input buffer (from host) and copying for SPI_NumBytesTx */
-            memcpy(aXiom_Tx_Buffer, &pTBPCommandReport[3], aXiom_NumBytesTx);
-
-            // don't need to react to status as they are sent to host in response packet
-            (void)Comms_Sequence();
-
-            // want a response immediately, so set up to send at end of this function
-            memcpy(pTBPCommandReport, aXiom_Rx_Buffer[CircularBufferHead], USBD_GENERIC_HID_REPORT_IN_SIZE);
+            /* Command bytes
+             * none
+             *
+             * acted on as soon as it arrives (on the OUT endpoints, even if the command FIFO is full) - a CMD_WAIT_FOR_CONDITION or
+             * CMD_REGION_CRC still waiting to respond then does so straight away with WAIT_CANCELLED/CRC_CANCELLED, and a CMD_BLOCK_WRITE_DATA
+             * waiting for aXiom is acknowledged with BLOCK_WRITE_NOT_READY (session closed). This command is queued like any other, so
+             * its own response comes after that one
+             *
+             * RETURN
+             * 1: 0x00
+             */
+            boCancelDeferred = 0;   // whatever it was meant for has responded by now
+            pTBPCommandReport[1] = 0x00;
             break;
         }
 //-------
@@ -343,9 +1512,7 @@ void ProcessTBPCommand()
                 else
                 {
                     //calculate how many bytes long the usage is?
-                    usage_length_in_bytes = ((usagetable[usage_table_idx].maxoffset & 0x80) == 0x00) ?
-                                            ((uint16_t)usagetable[usage_table_idx].numpages) * (((uint16_t)(usagetable[usage_table_idx].maxoffset & 0x7F) + 1) * 2) :
-                                            (((uint16_t)usagetable[usage_table_idx].numpages - 1) << 7) + (((uint16_t)(usagetable[usage_table_idx].maxoffset & 0x7F) + 1) * 2);
+                    usage_length_in_bytes = UsageLengthInBytes(usage_table_idx);
 
                     // if reading the host can ask for 0 bytes --> indicates they want to read the usage table entry
                     if((pTBPCommandReport[0] == CMD_READ_USAGE) && (pTBPCommandReport[4] == 0))
@@ -362,9 +1529,7 @@ void ProcessTBPCommand()
                         {
                             memset(aXiom_Tx_Buffer, 0, sizeof(aXiom_Tx_Buffer));
 
-                            start_address = ((usagetable[usage_table_idx].maxoffset & 0x80) == 0x00) ?
-                                         ((uint16_t)usagetable[usage_table_idx].startpage << 8) + (((uint16_t)pTBPCommandReport[2] * ((uint16_t)(usagetable[usage_table_idx].maxoffset & 0x7F) + 1)) * 2) + pTBPCommandReport[3] :
-                                         ((uint16_t)usagetable[usage_table_idx].startpage << 8) + (((uint16_t)pTBPCommandReport[2] * 2) + pTBPCommandReport[3]);
+                            start_address = UsageAddress(usage_table_idx, pTBPCommandReport[2], pTBPCommandReport[3]);
 
                             aXiom_Tx_Buffer[0] = (uint8_t)(start_address & 0xFF);
                             aXiom_Tx_Buffer[1] = (uint8_t)((start_address >> 8) & 0xFF);
@@ -433,19 +1598,220 @@ void ProcessTBPCommand()
             break;
         }
 //-------
+        case CMD_PROXY_PACKED_FRAMING: //0x8C
+        {
+            /* Command bytes (send before CMD_START_PROXY - any command on the generic interface stops proxy mode)
+             * 1: non-zero = queued proxy reports are packed together
+             *
+             * RETURN
+             * 1: PROXY_SETTINGS_OK, or INVALID_SETTINGS if packing was asked for but the ring can only hold one report (STM32F042x6) - left off
+             */
+#if (MAX_NUM_RX_BUFFERS > 2U)
+            boProxyPackedFraming = (pTBPCommandReport[1] != 0);
+            pTBPCommandReport[1] = PROXY_SETTINGS_OK;
+#else
+            // packing needs at least 2 reports waiting in the ring, a 2 slot ring never has more than 1
+            boProxyPackedFraming = false;
+            pTBPCommandReport[1] = (pTBPCommandReport[1] != 0) ? INVALID_SETTINGS : PROXY_SETTINGS_OK;
+#endif
+            break;
+        }
+//-------
+        case CMD_PROXY_REPORT_FILTER: //0x8D
+        {
+            /* Command bytes (send before CMD_START_PROXY)
+             * 1: no. entries (0 = forward every report)
+             * 2+: pairs of (report usage number, decimation) --> decimation 0/1 forwards every report, n forwards 1 in every n
+             *
+             * RETURN
+             * 1: PROXY_SETTINGS_OK, or INVALID_SETTINGS if there are too many entries
+             * 2: no. entries now in use
+             */
+            if(SetProxyReportFilter(&pTBPCommandReport[2], pTBPCommandReport[1]) == false)
+            {
+                pTBPCommandReport[1] = INVALID_SETTINGS;
+            }
+            else
+            {
+                pTBPCommandReport[1] = PROXY_SETTINGS_OK;
+            }
+            pTBPCommandReport[2] = byNumProxyFilterEntries;
+            break;
+        }
+//-------
         case CMD_BLOCK_DIGITIZER_REPORTS: //0x87   /* enables/disables mouse reports */
         {
             boMouseEnabled = (pTBPCommandReport[1] == 0);   // if command byte is non-zero then the digitizer is disabled
-            boProxyEnabled = boProxyMode_temp;  // restore the mode proxy was in before function was called
-            boInternalProxy = boInternalProxy_temp; // restore the mode proxy was in before function was called
+            RestoreProxyMode(boProxyMode_temp, boInternalProxy_temp);
+            break;
+        }
+//-------
+        case CMD_DIGITIZER_DELTA_REPORTS: //0x89
+        {
+            boDigitizerDeltaMode = (pTBPCommandReport[1] != 0);   // if command byte is non-zero then only changed/active contacts are sent
+            RestoreProxyMode(boProxyMode_temp, boInternalProxy_temp);
+            break;
+        }
+//-------
+        case CMD_REPORT_QUEUE_CONFIG: //0x8A
+        {
+            struct reportqueue_st *queue = NULL;
+
+            /* Command bytes
+             * 1: interface (0 = generic proxy ring - read only, 1 = press, 2 = mouse)
+             * 2: policy (0 = latest wins, 1 = fifo, 2 = max age, 0xFF = leave as is)
+             * 3-4: max age in ms (only used by max age policy)
+             * 5: non-zero clears the drop counters
+             *
+             * RETURN
+             * 1: interface
+             * 2: policy
+             * 3-4: max age in ms
+             * 5-6: no. reports dropped (replaced or queue full)
+             * 7-8: no. reports aged out
+             * 9: no. reports currently queued
+             * 10: queue depth
+             */
+
+            if(pTBPCommandReport[1] == GENERIC)
+            {
+                // generic proxy reports use the aXiom rx ring which is always fifo with backpressure (dropped = no. times the ring was full)
+                if(pTBPCommandReport[2] != 0xFF)
+                {
+                    pTBPCommandReport[1] = INVALID_SETTINGS;
+                }
+                else
+                {
+                    if(pTBPCommandReport[5] != 0)
+                    {
+                        wdRxBufferOverflows = 0;
+                    }
+
+                    memset(&pTBPCommandReport[2], 0x00, 9);
+                    pTBPCommandReport[2]  = QUEUE_FIFO;
+                    pTBPCommandReport[5]  = (uint8_t)(wdRxBufferOverflows & 0xFF);
+                    pTBPCommandReport[6]  = (uint8_t)(wdRxBufferOverflows >> 8);
+                    pTBPCommandReport[9]  = (uint8_t)CircularBuffer_Count();
+                    pTBPCommandReport[10] = MAX_NUM_RX_BUFFERS - 1;
+                }
+            }
+            else
+            {
+                if(pTBPCommandReport[1] == PRESS)
+                {
+                    queue = &press_report_queue;
+                }
+                else if(pTBPCommandReport[1] == MOUSE)
+                {
+                    queue = &mouse_report_queue;
+                }
+
+                if((queue == NULL) || ((pTBPCommandReport[2] > QUEUE_MAX_AGE) && (pTBPCommandReport[2] != 0xFF)))
+                {
+                    pTBPCommandReport[1] = INVALID_SETTINGS;
+                }
+                else
+                {
+                    if(pTBPCommandReport[2] != 0xFF)
+                    {
+                        ReportQueue_Flush(queue);   // don't want reports queued under the old policy hanging around
+                        queue->policy     = pTBPCommandReport[2];
+                        queue->max_age_ms = (uint16_t)pTBPCommandReport[3] | ((uint16_t)pTBPCommandReport[4] << 8);
+                    }
+
+                    if(pTBPCommandReport[5] != 0)
+                    {
+                        queue->dropped  = 0;
+                        queue->aged_out = 0;
+                    }
+
+                    pTBPCommandReport[2]  = queue->policy;
+                    pTBPCommandReport[3]  = (uint8_t)(queue->max_age_ms & 0xFF);
+                    pTBPCommandReport[4]  = (uint8_t)(queue->max_age_ms >> 8);
+                    pTBPCommandReport[5]  = (uint8_t)(queue->dropped & 0xFF);
+                    pTBPCommandReport[6]  = (uint8_t)(queue->dropped >> 8);
+                    pTBPCommandReport[7]  = (uint8_t)(queue->aged_out & 0xFF);
+                    pTBPCommandReport[8]  = (uint8_t)(queue->aged_out >> 8);
+                    pTBPCommandReport[9]  = queue->count;
+                    pTBPCommandReport[10] = REPORT_QUEUE_DEPTH;
+                }
+            }
+
+            RestoreProxyMode(boProxyMode_temp, boInternalProxy_temp);
+            break;
+        }
+//-------
+        case CMD_SCHEDULER_STATS: //0x8E
+        {
+            uint8_t byTask = pTBPCommandReport[1];
+
+            /* Command bytes
+             * 1: task, TASK_xxx in Scheduler.h (0 = proxy read, 1 = usb in, 2 = command, 3 = housekeeping, 4 = block read,
+             *    5 = frame stream, 6 = watch list, 7 = script, 8 = usage snapshot)
+             * 2: non-zero clears the task's figures after they've been read
+             *
+             * RETURN
+             * 1: PROXY_SETTINGS_OK, or INVALID_SETTINGS if the task doesn't exist
+             * 2: no. tasks
+             * 3-6: no. times the task has run
+             * 7-10: total run time (us)
+             * 11-14: longest run (us)
+             * 15-18: longest wait from event posted to task starting (us)
+             */
+            if(byTask >= NUM_TASKS)
+            {
+                pTBPCommandReport[1] = INVALID_SETTINGS;
+                pTBPCommandReport[2] = NUM_TASKS;
+            }
+            else
+            {
+                bool boClear = (pTBPCommandReport[2] != 0);
+
+                pTBPCommandReport[1] = PROXY_SETTINGS_OK;
+                pTBPCommandReport[2] = NUM_TASKS;
+                memcpy(&pTBPCommandReport[3],  &scheduler_tasks[byTask].runs,           sizeof(uint32_t));
+                memcpy(&pTBPCommandReport[7],  &scheduler_tasks[byTask].total_run_us,   sizeof(uint32_t));
+                memcpy(&pTBPCommandReport[11], &scheduler_tasks[byTask].max_run_us,     sizeof(uint32_t));
+                memcpy(&pTBPCommandReport[15], &scheduler_tasks[byTask].max_latency_us, sizeof(uint32_t));
+
+                if(boClear)
+                {
+                    Scheduler_ClearStats(byTask);
+                }
+            }
+
+            RestoreProxyMode(boProxyMode_temp, boInternalProxy_temp);
+            break;
+        }
+//-------
+        case CMD_CONCURRENT_COMMANDS: //0x8F
+        {
+            /* Command bytes
+             * 1: non-zero = commands run alongside proxy streaming (only CMD_ZERO, CMD_NULL and CMD_MULTIPAGE_READ stop it)
+             *    zero     = any command on the generic interface stops proxy (TH2 behaviour)
+             */
+            boConcurrentCommands = (pTBPCommandReport[1] != 0);
+
+            RestoreProxyMode(boProxyMode_temp, boInternalProxy_temp);
+            break;
+        }
+//-------
+        case CMD_COMMAND_PIPELINING: //0x90
+        {
+            /* Command bytes
+             * 1: non-zero = the last byte of every command is a sequence id, echoed in the last byte of its response
+             *    (commands and responses then only have 63 bytes to play with)
+             */
+            boCommandPipelining = (pTBPCommandReport[1] != 0);
+
+            RestoreProxyMode(boProxyMode_temp, boInternalProxy_temp);
             break;
         }
 //-------
         case CMD_BLOCK_PRESS_REPORTS: //0xB1
         {
             boBlockPressReports = (pTBPCommandReport[1] != 0);
-            boProxyEnabled = boProxyMode_temp;  // reinstate previous proxy mode
-            boInternalProxy = boInternalProxy_temp; // restore the mode proxy was in before function was called
+            RestoreProxyMode(boProxyMode_temp, boInternalProxy_temp);
             break;
         }
 
@@ -589,3 +1955,252 @@ void ProcessTBPCommand()
     }
     boCommandWaitingToDecode = 0;
 }
+
+/*-----------------------------------------------------------*/
+
+/* called from the OUT endpoint callbacks (interrupt) - copies the command so the endpoint buffer can be re-used straight away
+ * the generic and press endpoints share the FIFO, so a command can arrive on one after the other has filled it - it's left in the
+ * endpoint buffer (endpoint not re-armed) and queued as soon as an entry is freed
+ * returns USBD_OK if the endpoint can be re-armed, USBD_BUSY if it has to wait for an entry to be finished with */
+int8_t CommandFIFO_Receive(uint8_t byInterface, uint8_t *pReport)
+{
+    CommandFIFO_CheckCancel(pReport);
+
+    if((CommandFIFO_Count() + boControlSlotReserved) >= COMMAND_FIFO_DEPTH)
+    {
+        CommandFIFO_PauseOut(byInterface, pReport);
+        return USBD_BUSY;
+    }
+
+    CommandFIFO_Push(byInterface, pReport);
+
+    if((CommandFIFO_Count() + boControlSlotReserved) >= COMMAND_FIFO_DEPTH)
+    {
+        CommandFIFO_PauseOut(byInterface, NULL);
+        return USBD_BUSY;
+    }
+
+    return USBD_OK;
+}
+
+/*-----------------------------------------------------------*/
+
+/* control endpoint SET_REPORT, SETUP stage (interrupt) - keeps an entry back for the data stage, which can't be NAKed like the OUT
+ * endpoints. Returns the buffer to receive the data into, or NULL if the FIFO is full - the request is then stalled so the host knows
+ * the command wasn't taken. A reservation left by a SET_REPORT the host abandoned is re-used by the next one */
+uint8_t *CommandFIFO_ReserveControl(void)
+{
+    if(boControlSlotReserved == 0)
+    {
+        if(CommandFIFO_Count() >= COMMAND_FIFO_DEPTH)
+        {
+            return NULL;
+        }
+        boControlSlotReserved = 1;
+    }
+
+    return control_report;
+}
+
+/*-----------------------------------------------------------*/
+
+// control endpoint SET_REPORT, data stage (interrupt) - always goes in, the entry was kept back by CommandFIFO_ReserveControl()
+int8_t CommandFIFO_ReceiveControl(uint8_t byInterface)
+{
+    if(boControlSlotReserved == 0)
+    {
+        return USBD_FAIL;
+    }
+
+    boControlSlotReserved = 0;
+    CommandFIFO_CheckCancel(control_report);
+    CommandFIFO_Push(byInterface, control_report);
+
+    return USBD_OK;
+}
+
+/*-----------------------------------------------------------*/
+
+// runs the oldest command in the FIFO - one at a time, the next isn't started until this one's response has gone out so replies stay in order
+void CommandFIFO_Service(void)
+{
+    struct commandentry_st *entry;
+    uint8_t bySequence;
+
+    if((boCommandInProgress == 0) && (CommandFIFO_Count() > 0))
+    {
+        entry = &command_fifo[byCommandFIFOTail % COMMAND_FIFO_DEPTH];
+        bySequence = entry->report[COMMAND_SEQUENCE_BYTE];
+
+        target_interface = entry->interface;
+        if(entry->interface == GENERIC_INTERFACE_NUM)
+        {
+            pTBPCommandReportGeneric = entry->report;
+        }
+        else
+        {
+            pTBPCommandReportPress = entry->report;
+        }
+
+        ProcessTBPCommand();
+
+        if((boGenericTBPResponseWaiting == 1) || (boPressTBPResponseWaiting == 1) || (boResponseDeferred == 1))
+        {
+            if(boCommandPipelining)
+            {
+                pTBPCommandReport[COMMAND_SEQUENCE_BYTE] = bySequence;
+            }
+            boCommandInProgress = 1;    // entry holds the response, it's freed by CommandFIFO_ResponseSent()
+        }
+        else
+        {
+            CommandFIFO_Pop();
+        }
+    }
+
+    // proxy only needs to hold off for commands that haven't been run yet, and can be run next
+    boCommandWaitingToDecode = (boResponseDeferred == 0) && (CommandFIFO_Count() > (boCommandInProgress ? 1u : 0u));
+}
+
+/*-----------------------------------------------------------*/
+
+// called every 1ms - carries on with a CMD_WAIT_FOR_CONDITION that didn't finish straight away, the response then goes out as normal
+void WaitForCondition_Tick(void)
+{
+    if(wait_condition.boActive && boCancelDeferred)
+    {
+        WaitConditionResponse(WAIT_CANCELLED);
+        SendDeferredResponse(wait_condition.interface);
+        return;
+    }
+
+    if((wait_condition.boActive == false) || ((HAL_GetTick() - wait_condition.last_poll_ms) < wait_condition.interval_ms))
+    {
+        return;
+    }
+
+    if(PollWaitCondition())
+    {
+        SendDeferredResponse(wait_condition.interface);
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+// called every 1ms - passes a CMD_BLOCK_WRITE_DATA packet that's waiting for aXiom to be ready back in, at the session's poll interval
+void BlockWriteData_Tick(void)
+{
+    uint8_t byPayloadEnd = (boCommandPipelining) ? COMMAND_SEQUENCE_BYTE : COMMAND_ENTRY_SIZE;
+    bool    boAck;
+
+    if((boResponseDeferred == 0) || (BlockWrite_PacketWaiting() == false))
+    {
+        return;
+    }
+
+    if(boCancelDeferred)
+    {
+        BlockWrite_Cancel(pTBPCommandReport, byPayloadEnd);
+        SendDeferredResponse(byBlockWriteInterface);
+        return;
+    }
+
+    if(BlockWrite_RetryDue() == false)
+    {
+        return;
+    }
+
+    boAck = BlockWrite_Data(pTBPCommandReport, byPayloadEnd);
+    if(BlockWrite_PacketWaiting())
+    {
+        return;
+    }
+
+    if(boAck)
+    {
+        SendDeferredResponse(byBlockWriteInterface);
+    }
+    else
+    {
+        DropDeferredResponse();
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+/* reads the next piece of a CMD_REGION_CRC range (split at page boundaries) and adds it to the CRC, the response goes once it's all read
+ * returns true if there's more to read straight away - called from the block read task, which carries on posting itself while a
+ * multi-page read is in progress so that's waited out without this asking to be run again */
+bool RegionCRC_ReadNext(void)
+{
+    uint16_t wdChunk;
+    uint8_t  byStatus;
+
+    if(region_crc.boActive == false)
+    {
+        return false;
+    }
+
+    if(boCancelDeferred)
+    {
+        RegionCRCResponse(CRC_CANCELLED);
+        return false;
+    }
+
+    // a multi-page read relies on aXiom_Tx_Buffer staying put between reads
+    if(ProxyMP_TotalNumBytesRx != 0)
+    {
+        return false;
+    }
+
+    wdChunk = AXIOM_PAGE_SIZE - (region_crc.address & (AXIOM_PAGE_SIZE - 1));
+    if(wdChunk > CRC_READ_CHUNK)
+    {
+        wdChunk = CRC_READ_CHUNK;
+    }
+    if(wdChunk > region_crc.remaining)
+    {
+        wdChunk = (uint16_t)region_crc.remaining;
+    }
+
+    aXiom_Tx_Buffer[0] = (uint8_t)(region_crc.address & 0xFF);
+    aXiom_Tx_Buffer[1] = (uint8_t)(region_crc.address >> 8);
+    aXiom_Tx_Buffer[2] = (uint8_t)wdChunk;
+    aXiom_Tx_Buffer[3] = READ;
+    aXiom_NumBytesTx = 4;
+    aXiom_NumBytesRx = wdChunk;
+
+    (void)Comms_Sequence();
+    byStatus = aXiom_Rx_Buffer[CircularBufferHead][0];
+
+    if(byStatus == COMMS_OK)
+    {
+        region_crc.crc = ComputeCRC32(region_crc.crc, &aXiom_Rx_Buffer[CircularBufferHead][2], wdChunk);
+        region_crc.address   += wdChunk;
+        region_crc.remaining -= wdChunk;
+    }
+
+    if(byStatus != COMMS_OK)
+    {
+        RegionCRCResponse(CRC_COMMS_ERROR);
+    }
+    else if(region_crc.remaining == 0)
+    {
+        RegionCRCResponse(((region_crc.boCompare == false) || (~region_crc.crc == region_crc.expected)) ? CRC_MATCH : CRC_MISMATCH);
+    }
+
+    return region_crc.boActive;
+}
+
+/*-----------------------------------------------------------*/
+
+// called once the response to the command at the tail has been handed to the IN endpoint
+void CommandFIFO_ResponseSent(void)
+{
+    if(boCommandInProgress)
+    {
+        boCommandInProgress = 0;
+        CommandFIFO_Pop();
+        Scheduler_PostEvent(TASK_COMMAND);
+    }
+}
@@ -36,6 +36,7 @@
 #include "I2C_Comms.h"
 #include "Proxy_driver.h"
 #include "Usage_Builder.h"
+#include "Script_Engine.h"
 #include "usbd_generic.h"
 #include "usbd_generic_if.h"
 #include "usb_device.h"
@@ -48,8 +49,11 @@
 /*============ Exported Variables ============*/
 bool        boCommsInProcess = 0;          // command waiting to be sent to connected device --> starts and comms
 
-uint32_t    CircularBufferHead  = 0;
-uint32_t    CircularBufferTail = 0;
+// single producer (aXiom reads) / single consumer (generic endpoint) ring - one slot is always kept free as the write slot for the next read,
+// so the ring is full when (head + 1) == tail and empty when head == tail. Only the producer moves the head and only the consumer moves the tail
+volatile uint32_t CircularBufferHead  = 0;
+volatile uint32_t CircularBufferTail  = 0;
+uint16_t    wdRxBufferOverflows = 0;    // no. times a report was left waiting on aXiom because the ring was full
 
 uint8_t     comms_mode = 1;
 
@@ -62,6 +66,55 @@ uint16_t    aXiom_NumBytesRx = 0; // number of bytes we're reading from aXiom
 /*============ Local Function Prototypes ============*/
 
 /*============ Functions ============*/
+bool CircularBuffer_IsFull(void)
+{
+    return (((CircularBufferHead + 1) % MAX_NUM_RX_BUFFERS) == CircularBufferTail);
+}
+
+//--------------------------
+
+bool CircularBuffer_IsEmpty(void)
+{
+    return (CircularBufferHead == CircularBufferTail);
+}
+
+//--------------------------
+
+uint32_t CircularBuffer_Count(void)
+{
+    return ((CircularBufferHead + MAX_NUM_RX_BUFFERS - CircularBufferTail) % MAX_NUM_RX_BUFFERS);
+}
+
+//--------------------------
+
+// producer - publishes the slot at the head (which has just been filled), returns false if there's no room (caller decides what to do)
+bool CircularBuffer_Push(void)
+{
+    if(CircularBuffer_IsFull())
+    {
+        return false;
+    }
+
+    __DMB();    // slot contents must be written before the consumer can see the new head
+    CircularBufferHead = (CircularBufferHead + 1) % MAX_NUM_RX_BUFFERS;
+
+    return true;
+}
+
+//--------------------------
+
+// consumer - releases the slot at the tail once it has been sent
+void CircularBuffer_Pop(void)
+{
+    if(CircularBuffer_IsEmpty() == false)
+    {
+        __DMB();    // finish with the slot before handing it back to the producer
+        CircularBufferTail = (CircularBufferTail + 1) % MAX_NUM_RX_BUFFERS;
+    }
+}
+
+//--------------------------
+
 HAL_StatusTypeDef Comms_Sequence(void)
 {
     uint8_t status = 0;
@@ -103,18 +156,13 @@ HAL_StatusTypeDef Comms_Sequence(void)
                 aXiom_Rx_Buffer[CircularBufferHead][0] = COMMS_TIMEOUT;
             }
 
+            Script_Event(SCRIPT_EVENT_COMMS_ERROR);
             break;
         }
 
         // check if spi comms have finished when leaving the function (checked regularly as this is spun through whilst boCommsInProcess is true)
         if(boCommsInProcess == 0)
         {
-            if((boProxyEnabled == 1) || (boInternalProxy == 1) || (ProxyMP_TotalNumBytesRx != 0))
-            {
-                // SPI comms from a proxy event
-                boProxyReportToProcess = 1;
-            }
-
             status = HAL_OK;
         }
 
@@ -124,6 +172,7 @@ HAL_StatusTypeDef Comms_Sequence(void)
             boCommsInProcess = 0;
             aXiom_Rx_Buffer[CircularBufferHead][0] = COMMS_TIMEOUT;
             status = HAL_TIMEOUT;
+            Script_Event(SCRIPT_EVENT_COMMS_ERROR);
             break;
         }
 
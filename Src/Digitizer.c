@@ -45,10 +45,12 @@
 #include "Press_driver.h"
 #include "Usage_Builder.h"
 #include "Mode_Control.h"
+#include "Report_Queue.h"
 
 /*============ Defines ============*/
 #define U41_REPORT              (0x41)
-#define MAX_NUM_CONTACTS        (5)
+#define CONTACTS_PER_PACKET     (5)     // hybrid mode: no. contact collections in each digitizer report (matches the report descriptor)
+#define MAX_PACKETS_PER_FRAME   (DIGITIZER_MAX_CONTACTS / CONTACTS_PER_PACKET)
 #define TOUCH_NUMBER            (1)
 
 #define CONFIDENCE              (0x04)
@@ -67,6 +69,15 @@
 #define BUTTON_PRESS            (0x02)
 #define BUTTON_RELEASE          (0x00)
 #define DATABYTES_PER_TOUCH     (7)
+#define RIGHT_CLICK_HOLD_MS     (30)    // how long the right button is held down for a two finger tap
+#define CLICK_IDLE              (0)
+#define CLICK_PRESSED           (1)
+#define REMOTE_WAKEUP_SIGNAL_MS (10)    // length of the resume signal we drive onto the bus (USB spec allows 1-15ms)
+#define REMOTE_WAKEUP_RETRY_MS  (50)    // gap before signalling again if the host still hasn't resumed and touches keep coming
+#define WAKE_REPLAY_TIMEOUT_MS  (1000)  // held frames older than this are stale by the time the host resumes, so they're dropped
+#define FIRST_WAKE_FRAME        (0)     // the frame that woke the host
+#define LATEST_WAKE_FRAME       (1)     // the most recent frame seen while waiting for the host to resume
+#define NUM_WAKE_FRAMES         (2)
 
 /*============ Macros ============*/
 #define ALIGN_WITH_CORRECT_TOUCH(x) ((x-1)*DATABYTES_PER_TOUCH)
@@ -78,6 +89,15 @@ uint8_t     byReportX_msb, byReportX_lsb;
 uint8_t     byReportY_msb, byReportY_lsb;
 uint8_t     byReportZ_msb, byReportZ_lsb;
 uint8_t     button_state;
+uint16_t    wdContactsReportedWas = 0;  // bitmask of the contacts that were present in the last frame - they need reporting once more when lifted
+uint8_t     last_contact_data[DIGITIZER_MAX_CONTACTS * DATABYTES_PER_TOUCH] = {0};  // contact data of the last frame sent in delta mode (used to drop repeats)
+uint8_t     byLastContactCount = 0;
+uint8_t     right_click_state = CLICK_IDLE;
+uint32_t    right_click_start_ms = 0;   // HAL tick when the button press was queued
+uint8_t     wake_frames[NUM_WAKE_FRAMES][USBD_GENERIC_HID_REPORT_IN_SIZE] = {0};
+uint8_t     byNumWakeFrames = 0;
+bool        boWakeSignalActive = 0;
+uint32_t    wake_signal_start_ms = 0;   // HAL tick when remote wakeup signalling last started
 
 //This table was extracted from online tool at http://www.sunshine2k.de/coding/javascript/crc/crc_js.html and verified with one other online source
 //Note that it may also be known as 0xA001 in reverse polynomial notation (i.e. 0x8005 backwards)
@@ -117,21 +137,27 @@ const uint16_t CRC16_IBM_8005_Table[256] = {
 };
 
 /*============ Exported Variables ============*/
-volatile uint16_t wd100usTick                               =  0;       // this is used to mark the digitizer packet with a timestamp --> incremented in SysTick_Handler every millisecond, Windows is expecting this value to overflow/wrap around, it is used as a reference from when the first touch is registered (after a period of not touching)
 volatile uint16_t wdUSB1msTick                              =  0;       // this is used as a timer to re-activate proxy mode after TH2/host disconnects
 uint8_t  u34_TCP_report[USBD_GENERIC_HID_REPORT_IN_SIZE]    = {0};      // note: u34 is the FIFO buffer on aXiom that all reports come out on --> digitizer report is an u41, but we see it coming in the u34 buffer!
 uint8_t  byNumTouches                                       =  0;
-uint8_t  touch_data[5][8]                                   = {0};
+uint8_t  touch_data[DIGITIZER_MAX_CONTACTS][8]              = {0};
 uint8_t  usb_remote_wake_state                              =  RESUMED;
 bool     boUSBTimeoutEnabled                                =  0;
 bool     boMouseEnabled                                     =  1;       // starts with digitizer enable (TH2 doesn't know the command to toggle it!)
+bool     boDigitizerDeltaMode                               =  0;       // only send active/lifted contacts and drop repeated frames (set by host)
 uint8_t  wakeup_option                                      =  0;
 
 /*============ Local Function Prototypes ============*/
 static uint8_t GetXYZFromReport(bool boIgnoreCoords, uint8_t byTouchNum);
 static void    DecodeOneTouch(uint8_t byTouchToCheck, uint8_t *byStatus, uint8_t *wdXCoord, uint8_t *wdYCoord, uint8_t *byZAmplitude);
 static void    PrepareAbsMouseReport(void);
-static void    SendMouseRightClick(void);
+static void    StartMouseRightClick(void);
+static void    StartRemoteWakeup(void);
+static void    HoldFrameForWakeup(bool boWakeHost);
+static void    BuildDigitizerPacket(uint8_t *pPacket, uint8_t *pTouchList, uint8_t byNumTouchesInPacket, uint8_t byContactCount, uint16_t digitizer_timer);
+#if defined(STM32F072xB)
+static uint16_t ComputeCRC16_HW(uint8_t *Buffer, uint32_t Len);
+#endif
 
 /*============ Local Functions ============*/
 
@@ -161,16 +187,21 @@ uint8_t CheckTouches(void)
     uint8_t NumTouches = 0;
     uint8_t TouchNum;
 
-    for(TouchNum = 1; TouchNum <= 5; TouchNum++)
+    uint16_t wdContactsPresent;
+
+    for(TouchNum = 1; TouchNum <= DIGITIZER_MAX_CONTACTS; TouchNum++)
     {
         DecodeOneTouch(TouchNum, &touch_data[TouchNum - 1][0], &touch_data[TouchNum - 1][1], &touch_data[TouchNum - 1][3], &touch_data[TouchNum - 1][5]);
     }
 
-    NumTouches = ((u34_TCP_report[2] & 1)  ? 1 : 0)  +   // these bits indicate how many touches are present on the screen
-                 ((u34_TCP_report[2] & 2)  ? 1 : 0)  +
-                 ((u34_TCP_report[2] & 4)  ? 1 : 0)  +
-                 ((u34_TCP_report[2] & 8)  ? 1 : 0)  +
-                 ((u34_TCP_report[2] & 16) ? 1 : 0);
+    // these bits indicate how many touches are present on the screen - one per contact, spread over bytes 2 and 3
+    wdContactsPresent = (u34_TCP_report[2] | (u34_TCP_report[3] << 8)) & ((1u << DIGITIZER_MAX_CONTACTS) - 1u);
+
+    while(wdContactsPresent)
+    {
+        NumTouches += (wdContactsPresent & 1u);
+        wdContactsPresent >>= 1;
+    }
 
     return NumTouches;
 }
@@ -210,23 +241,114 @@ static void PrepareAbsMouseReport(void)
     usb_hid_mouse_report_in[3] = TempY & 0xFF;
     usb_hid_mouse_report_in[4] = TempY >> 8;
 
-    boMouseReportToSend = 1;
+    (void)ReportQueue_Push(&mouse_report_queue, usb_hid_mouse_report_in, byMouseReportLength, true);
 }
 
 /*-----------------------------------------------------------*/
 
-static void SendMouseRightClick(void)
+// queues the button press, the release is queued RIGHT_CLICK_HOLD_MS later by MouseRightClickTask() so nothing waits here
+static void StartMouseRightClick(void)
 {
-    // send button press -> wait 30ms -> send button release
+    if(right_click_state != CLICK_IDLE)
+    {
+        return;
+    }
+
     button_state = BUTTON_PRESS;
     PrepareAbsMouseReport();
-    Send_USB_Report(MOUSE, &hUsbDeviceFS, usb_hid_mouse_report_in, byMouseReportLength);
 
-    HAL_Delay(30);
+    right_click_start_ms = HAL_GetTick();
+    right_click_state = CLICK_PRESSED;
+}
 
-    button_state = BUTTON_RELEASE;
-    PrepareAbsMouseReport();
-    Send_USB_Report(MOUSE, &hUsbDeviceFS, usb_hid_mouse_report_in, byMouseReportLength);
+/*-----------------------------------------------------------*/
+
+// starts driving resume signalling onto the bus, RemoteWakeupTask() stops it again after REMOTE_WAKEUP_SIGNAL_MS
+static void StartRemoteWakeup(void)
+{
+    HAL_PCD_ActivateRemoteWakeup(&hpcd_USB_FS);
+    wake_signal_start_ms = HAL_GetTick();
+    boWakeSignalActive = 1;
+}
+
+/*-----------------------------------------------------------*/
+
+// called with a touch frame that arrived while the host is asleep - keeps hold of it so it can be sent once the host resumes
+static void HoldFrameForWakeup(bool boWakeHost)
+{
+    if(usb_remote_wake_state == SUSPENDED)
+    {
+        if(boWakeHost)
+        {
+            memcpy(wake_frames[FIRST_WAKE_FRAME], u34_TCP_report, sizeof(u34_TCP_report));
+            byNumWakeFrames = 1;
+            StartRemoteWakeup();
+            usb_remote_wake_state = PENDING_WAKE;
+        }
+    }
+    else // PENDING_WAKE - still waiting for the host to resume
+    {
+        memcpy(wake_frames[LATEST_WAKE_FRAME], u34_TCP_report, sizeof(u34_TCP_report));   // so a lift-off that happens meanwhile isn't lost
+        byNumWakeFrames = NUM_WAKE_FRAMES;
+
+        if((boWakeSignalActive == 0) && ((HAL_GetTick() - wake_signal_start_ms) >= REMOTE_WAKEUP_RETRY_MS))
+        {
+            StartRemoteWakeup();
+        }
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+// fills one hybrid mode packet with the contacts listed in pTouchList, any unused slots are zeroed (host ignores slots beyond the contact count)
+static void BuildDigitizerPacket(uint8_t *pPacket, uint8_t *pTouchList, uint8_t byNumTouchesInPacket, uint8_t byContactCount, uint16_t digitizer_timer)
+{
+    uint8_t  bySlot;
+    uint8_t  byTouchNum;
+    uint8_t  touched;
+    uint16_t digitizer_pressure;
+
+    memset(pPacket, 0x00, MOUSE_PARALLEL_DIGITIZER_REPORT_LENGTH);
+    pPacket[0] = 1; //report number --> relates to the report number found in the report descriptor (allows windows to differentiate between different connected devices)
+
+    for(bySlot = 1u; bySlot <= byNumTouchesInPacket; bySlot++) // perform same processing for each touch
+    {
+        byTouchNum = pTouchList[bySlot - 1u];
+
+        if(GetXYZFromReport(DO_NOT_IGNORE_COORDS, byTouchNum))
+        {
+            if(byReportZ_lsb >= 0x80)   // if z coordinate is a negative value it indicates there is a hover or prox
+            {
+                touched = CONFIDENCE | IN_RANGE; // hover present --> set in range bit
+            }
+            else
+            {
+                touched = CONFIDENCE | IN_RANGE | TIP_SWITCH; // touch present --> set tip switch bit
+            }
+        }
+        else
+        {
+            touched = CONFIDENCE;
+        }
+
+        // translates the pressure value into the range 0-1024 (prevents Windows from messing with our values!)
+        digitizer_pressure = byReportZ_lsb;
+        digitizer_pressure = digitizer_pressure + 1;
+        digitizer_pressure = digitizer_pressure * 4;
+
+        pPacket[ALIGN_WITH_CORRECT_TOUCH(bySlot) + TOUCH_NUMBER]      = (uint8_t)(byTouchNum << 3u) | touched;
+        pPacket[ALIGN_WITH_CORRECT_TOUCH(bySlot) + X_COORD_LSB]       = (DigitizerXCoord >> 4) & 0xFF;
+        pPacket[ALIGN_WITH_CORRECT_TOUCH(bySlot) + X_COORD_MSB]       = (DigitizerXCoord >> 4) >> 8;
+        pPacket[ALIGN_WITH_CORRECT_TOUCH(bySlot) + Y_COORD_LSB]       = (DigitizerYCoord >> 4) & 0xFF;
+        pPacket[ALIGN_WITH_CORRECT_TOUCH(bySlot) + Y_COORD_MSB]       = (DigitizerYCoord >> 4) >> 8;
+        pPacket[ALIGN_WITH_CORRECT_TOUCH(bySlot) + PRESSURE_LSB]      = (uint8_t)(digitizer_pressure & 0xFF);
+        pPacket[ALIGN_WITH_CORRECT_TOUCH(bySlot) + PRESSURE_MSB]      = (uint8_t)((digitizer_pressure >> 8) & 0xFF);
+    }
+
+    // every packet in a frame carries the same scan time, only the first carries the contact count (the rest are 0)
+    pPacket[(CONTACTS_PER_PACKET * DATABYTES_PER_TOUCH) + 1] = digitizer_timer & 0xFF;
+    pPacket[(CONTACTS_PER_PACKET * DATABYTES_PER_TOUCH) + 2] = digitizer_timer >> 8;
+    pPacket[(CONTACTS_PER_PACKET * DATABYTES_PER_TOUCH) + 3] = byContactCount;
 }
 
 /*-----------------------------------------------------------*/
@@ -285,6 +407,33 @@ uint16_t ComputeCRC16(uint8_t *Buffer, uint32_t Len, uint16_t SeedCRC)
     return(SeedCRC);
 }
 
+/*-----------------------------------------------------------*/
+
+#if defined(STM32F072xB)
+// same result as ComputeCRC16(Buffer, Len, 0) but done by the CRC unit (set up in MX_CRC_Init) --> 4 bytes per write instead of a table look-up per byte
+static uint16_t ComputeCRC16_HW(uint8_t *Buffer, uint32_t Len)
+{
+    uint32_t Word;
+
+    CRC->CR |= CRC_CR_RESET;
+
+    while(Len >= 4)
+    {
+        memcpy(&Word, Buffer, 4);   // report buffer isn't necessarily word aligned
+        CRC->DR = __REV(Word);      // unit takes the most significant byte first, so swap to keep the bytes in buffer order
+        Buffer += 4;
+        Len -= 4;
+    }
+
+    while(Len--)
+    {
+        *(__IO uint8_t *)(&CRC->DR) = *Buffer++;
+    }
+
+    return (uint16_t)(CRC->DR & 0xFFFF);
+}
+#endif
+
 /*============ Exported Functions ============*/
 
 void CRC_Checksum(void) // Checks if CRC received data is correct
@@ -302,7 +451,11 @@ void CRC_Checksum(void) // Checks if CRC received data is correct
         }
         CRC_Report = u34_TCP_report[CRC_Offset] | (u34_TCP_report[CRC_Offset + 1] << 8);
 
+#if defined(STM32F072xB)
+        CRC_Calc = ComputeCRC16_HW(u34_TCP_report, CRC_Offset);
+#else
         CRC_Calc = ComputeCRC16(u34_TCP_report, CRC_Offset, 0);
+#endif
 
         if(CRC_Calc != CRC_Report)
         {
@@ -326,10 +479,19 @@ void CRC_Checksum(void) // Checks if CRC received data is correct
 void MultiPointDigitizer(void)
 {
     bool     boGotTouchReport;
+    bool     boSendFrame = true;
+    bool     boQueued = true;
     uint8_t  byTouchNum;
-    uint8_t  touched;
+    uint8_t  byWakeZ;
+    uint8_t  byNumContacts;
+    uint8_t  byNumPackets;
+    uint8_t  byPacket;
+    uint8_t  touch_list[DIGITIZER_MAX_CONTACTS];
+    uint8_t  contact_data[DIGITIZER_MAX_CONTACTS * DATABYTES_PER_TOUCH];
+    uint8_t  frame_packets[MAX_PACKETS_PER_FRAME][MOUSE_PARALLEL_DIGITIZER_REPORT_LENGTH];
+    uint16_t wdContactsActive;
+    uint16_t wdContactsToReport;
     uint16_t digitizer_timer;
-    uint16_t digitizer_pressure;
 
     boGotTouchReport = Check_u41Report();   // checks if we are actually dealing with a u41 report or not
 
@@ -339,69 +501,104 @@ void MultiPointDigitizer(void)
 
         if((usb_remote_wake_state == SUSPENDED) || (usb_remote_wake_state == PENDING_WAKE))
         {
-            if(usb_remote_wake_state == PENDING_WAKE)
+            // any contact can carry the hover/prox z value, so wake on the largest one (0x80 and above are the hover/prox values)
+            byWakeZ = 0;
+            for(byTouchNum = 0; byTouchNum < DIGITIZER_MAX_CONTACTS; byTouchNum++)
             {
-                HAL_PCD_ActivateRemoteWakeup(&hpcd_USB_FS);
-                HAL_Delay(10);
-                HAL_PCD_DeActivateRemoteWakeup(&hpcd_USB_FS);
-            }
-            else if((usb_remote_wake_state == SUSPENDED))
-            {
-                if(WakeupHost(byNumTouches, byReportZ_lsb) == true)
-                {
-                    usb_remote_wake_state = PENDING_WAKE;
-                }
-                else
+                if(touch_data[byTouchNum][5] > byWakeZ)
                 {
-                    // do nothing!
+                    byWakeZ = touch_data[byTouchNum][5];
                 }
             }
+
+            HoldFrameForWakeup(WakeupHost(byNumTouches, byWakeZ));
         }
         else // if(usb_remote_wake_state == RESUMED)
         {
-            usb_hid_mouse_report_in[0] = 1; //report number --> relates to the report number found in the report descriptor (allows windows to differentiate between different connected devices)
+            /* Hybrid mode - the contacts are reported CONTACTS_PER_PACKET at a time. A contact that has just been lifted still needs to be reported once
+             * more (as released) so it is kept in the list for one extra frame */
+            wdContactsActive = (u34_TCP_report[2] | (u34_TCP_report[3] << 8)) & ((1u << DIGITIZER_MAX_CONTACTS) - 1u);
+            wdContactsToReport = wdContactsActive | wdContactsReportedWas;
 
-            for(byTouchNum = 1u; byTouchNum <= MAX_NUM_CONTACTS; byTouchNum++) // perform same processing for each touch
+            byNumContacts = 0;
+            if(boDigitizerDeltaMode)
             {
-                if(GetXYZFromReport(DO_NOT_IGNORE_COORDS, byTouchNum))
+                // delta mode - only the contacts that are present or lifting off, packed into the first slots
+                for(byTouchNum = 1u; byTouchNum <= DIGITIZER_MAX_CONTACTS; byTouchNum++)
                 {
-                    if(byReportZ_lsb >= 0x80)   // if z coordinate is a negative value it indicates there is a hover or prox
+                    if(wdContactsToReport & (1u << (byTouchNum - 1u)))
                     {
-                        touched = CONFIDENCE | IN_RANGE; // hover present --> set in range bit
-                    }
-                    else
-                    {
-                        touched = CONFIDENCE | IN_RANGE | TIP_SWITCH; // touch present --> set tip switch bit
+                        touch_list[byNumContacts++] = byTouchNum;
                     }
                 }
-                else
+            }
+            else
+            {
+                // contacts 1-5 always go in the first packet (same as before), contacts 6-10 only when one of them is present or lifting off
+                byNumContacts = ((wdContactsToReport >> CONTACTS_PER_PACKET) != 0) ? DIGITIZER_MAX_CONTACTS : CONTACTS_PER_PACKET;
+                for(byTouchNum = 1u; byTouchNum <= byNumContacts; byTouchNum++)
                 {
-                    touched = CONFIDENCE;
+                    touch_list[byTouchNum - 1u] = byTouchNum;
                 }
+            }
+
+            byNumPackets = (byNumContacts + CONTACTS_PER_PACKET - 1u) / CONTACTS_PER_PACKET;
 
-                // translates the pressure value into the range 0-1024 (prevents Windows from messing with our values!)
-                digitizer_pressure = byReportZ_lsb;
-                digitizer_pressure = digitizer_pressure + 1;
-                digitizer_pressure = digitizer_pressure * 4;
-
-                usb_hid_mouse_report_in[ALIGN_WITH_CORRECT_TOUCH(byTouchNum) + TOUCH_NUMBER]      = (uint8_t)(byTouchNum << 3u) | touched;
-                usb_hid_mouse_report_in[ALIGN_WITH_CORRECT_TOUCH(byTouchNum) + X_COORD_LSB]       = (DigitizerXCoord >> 4) & 0xFF;
-                usb_hid_mouse_report_in[ALIGN_WITH_CORRECT_TOUCH(byTouchNum) + X_COORD_MSB]       = (DigitizerXCoord >> 4) >> 8;
-                usb_hid_mouse_report_in[ALIGN_WITH_CORRECT_TOUCH(byTouchNum) + Y_COORD_LSB]       = (DigitizerYCoord >> 4) & 0xFF;
-                usb_hid_mouse_report_in[ALIGN_WITH_CORRECT_TOUCH(byTouchNum) + Y_COORD_MSB]       = (DigitizerYCoord >> 4) >> 8;
-                usb_hid_mouse_report_in[ALIGN_WITH_CORRECT_TOUCH(byTouchNum) + PRESSURE_LSB]      = (uint8_t)(digitizer_pressure & 0xFF);
-                usb_hid_mouse_report_in[ALIGN_WITH_CORRECT_TOUCH(byTouchNum) + PRESSURE_MSB]      = (uint8_t)((digitizer_pressure >> 8) & 0xFF);
+            digitizer_timer = wdReportTimestamp; // Windows expects this to increment of 100 microseconds - TIM16 free-runs at 10kHz, latched when nIRQ fell
+
+            // frame is built locally first so a dropped frame doesn't disturb one that's still queued
+            for(byPacket = 0; byPacket < byNumPackets; byPacket++)
+            {
+                uint8_t byNumInPacket = byNumContacts - (byPacket * CONTACTS_PER_PACKET);
+                byNumInPacket = (byNumInPacket > CONTACTS_PER_PACKET) ? CONTACTS_PER_PACKET : byNumInPacket;
+
+                // contact count goes in the first packet only, can be set between a value of 5 and 10 in parallel mode --> windows digitizer requires at least 5 touches to work correctly
+                BuildDigitizerPacket(frame_packets[byPacket], &touch_list[byPacket * CONTACTS_PER_PACKET], byNumInPacket,
+                                     (byPacket == 0) ? byNumContacts : 0, digitizer_timer);
             }
 
-            digitizer_timer = wd100usTick; // Windows expects this to increment of 100 microseconds - so we do that!
+            if(boDigitizerDeltaMode)
+            {
+                // gather up the contact data just built (skipping report id, scan time and contact count) so it can be compared against the last frame
+                memset(contact_data, 0x00, sizeof(contact_data));
+                for(byPacket = 0; byPacket < byNumPackets; byPacket++)
+                {
+                    memcpy(&contact_data[byPacket * CONTACTS_PER_PACKET * DATABYTES_PER_TOUCH], &frame_packets[byPacket][1], CONTACTS_PER_PACKET * DATABYTES_PER_TOUCH);
+                }
 
-            usb_hid_mouse_report_in[(MAX_NUM_CONTACTS * DATABYTES_PER_TOUCH) + 1] = digitizer_timer & 0xFF;
-            usb_hid_mouse_report_in[(MAX_NUM_CONTACTS * DATABYTES_PER_TOUCH) + 2] = digitizer_timer >> 8;
-            usb_hid_mouse_report_in[(MAX_NUM_CONTACTS * DATABYTES_PER_TOUCH) + 3] = MAX_NUM_CONTACTS;   // contact count, can be set between a value of 5 and 10 --> windows digitizer requires at least 5 touches to work correctly
+                // nothing on the panel (and nothing lifting off) or nothing has changed since the last frame --> nothing to tell the host
+                if((byNumContacts == 0) ||
+                   ((byNumContacts == byLastContactCount) && (memcmp(contact_data, last_contact_data, sizeof(contact_data)) == 0)))
+                {
+                    boSendFrame = false;
+                }
+            }
 
-            u34_TCP_report[1] = 0x00;   // "consumes" the report so it isn't used again
+            if(boSendFrame)
+            {
+                // the packets of a frame are queued together so they go out in consecutive slots
+                for(byPacket = 0; byPacket < byNumPackets; byPacket++)
+                {
+                    if(ReportQueue_Push(&mouse_report_queue, frame_packets[byPacket], MOUSE_PARALLEL_DIGITIZER_REPORT_LENGTH, (byPacket == 0)) == false)
+                    {
+                        boQueued = false;
+                    }
+                }
+            }
 
-            boMouseReportToSend = 1;
+            /* what the host has been told only changes once the frame is queued - if it was dropped (e.g. the frame with a lift-off in it)
+             * the lifted contacts are reported again with the next frame, and delta mode doesn't mistake the next frame for a repeat */
+            if(boQueued)
+            {
+                wdContactsReportedWas = wdContactsActive;
+                if(boDigitizerDeltaMode)
+                {
+                    byLastContactCount = byNumContacts;
+                    memcpy(last_contact_data, contact_data, sizeof(contact_data));
+                }
+            }
+
+            u34_TCP_report[1] = 0x00;   // "consumes" the report so it isn't used again
 
         }
     }
@@ -427,16 +624,7 @@ void MouseDigitizer(void)
 
         if((usb_remote_wake_state == SUSPENDED) || (usb_remote_wake_state == PENDING_WAKE))
         {
-            if(usb_remote_wake_state == PENDING_WAKE)
-            {
-                HAL_PCD_ActivateRemoteWakeup(&hpcd_USB_FS);
-                HAL_Delay(10);
-                HAL_PCD_DeActivateRemoteWakeup(&hpcd_USB_FS);
-            }
-            else if((usb_remote_wake_state == SUSPENDED) && (byNumTouchesIs > 0))
-            {
-                usb_remote_wake_state = PENDING_WAKE;
-            }
+            HoldFrameForWakeup(byNumTouchesIs > 0);
         }
         else if(usb_remote_wake_state == RESUMED)
         {
@@ -446,19 +634,23 @@ void MouseDigitizer(void)
             {
                 if((byNumTouchesIs < 2) && (byNumTouchesWas == 2))
                 {
-                    SendMouseRightClick();
+                    StartMouseRightClick();
                     RightClickActive = true;
                 }
 
+                // while a right click is in progress it owns the mouse endpoint - its release report also ends any touch
                 if((byNumTouchesIs == 0) && (byNumTouchesWas > 0))
                 {
-                    button_state = 0;
-                    PrepareAbsMouseReport();
+                    if(right_click_state == CLICK_IDLE)
+                    {
+                        button_state = 0;
+                        PrepareAbsMouseReport();
+                    }
                     RightClickActive = false;
                 }
                 else
                 {
-                    if(boTouch1Is)
+                    if(boTouch1Is && (right_click_state == CLICK_IDLE))
                     {
                         button_state = RightClickActive ? 0 : 1;
                         PrepareAbsMouseReport();
@@ -473,6 +665,61 @@ void MouseDigitizer(void)
 
 /*-----------------------------------------------------------*/
 
+// called every pass of the main loop, finishes off a right click once the press has gone out and been held long enough
+void MouseRightClickTask(void)
+{
+    uint8_t byReportLength;
+
+    if(right_click_state == CLICK_PRESSED)
+    {
+        if(((HAL_GetTick() - right_click_start_ms) >= RIGHT_CLICK_HOLD_MS) && (ReportQueue_Peek(&mouse_report_queue, &byReportLength) == NULL))
+        {
+            button_state = BUTTON_RELEASE;
+            PrepareAbsMouseReport();
+            right_click_state = CLICK_IDLE;
+        }
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+// called every pass of the main loop, ends remote wakeup signalling and, once the host has resumed, sends the frames held while it was asleep
+void RemoteWakeupTask(void)
+{
+    uint8_t byFrame;
+
+    if((boWakeSignalActive == 1) && ((HAL_GetTick() - wake_signal_start_ms) >= REMOTE_WAKEUP_SIGNAL_MS))
+    {
+        HAL_PCD_DeActivateRemoteWakeup(&hpcd_USB_FS);
+        boWakeSignalActive = 0;
+    }
+
+    if((usb_remote_wake_state == RESUMED) && (byNumWakeFrames > 0) && (boWakeSignalActive == 0))
+    {
+        if(((HAL_GetTick() - wake_signal_start_ms) < WAKE_REPLAY_TIMEOUT_MS) && (boMouseEnabled == true))
+        {
+            for(byFrame = 0; byFrame < byNumWakeFrames; byFrame++)
+            {
+                memcpy(u34_TCP_report, wake_frames[byFrame], sizeof(u34_TCP_report));
+                boCRCCheckOK = 1;   // frames were only held if they'd already passed the CRC check
+
+                if(BridgeMode == PARALLEL_DIGITIZER)
+                {
+                    MultiPointDigitizer();
+                }
+                else if(BridgeMode == ABSOLUTE_MOUSE)
+                {
+                    MouseDigitizer();
+                }
+            }
+        }
+
+        byNumWakeFrames = 0;
+    }
+}
+
+/*-----------------------------------------------------------*/
+
 // sets parameters and flags to put the bridge in proxy mode at startup
 void setup_proxy_for_digitizer(void)
 {
@@ -389,3 +389,46 @@ void StartBootloader(void)
 }
 
 /*-----------------------------------------------------------*/
+
+/* Erases the (program memory) page at PageAddress and writes wdLength bytes to the start of it - wdLength of 0 just erases it
+ * the CPU stalls while the page is erased (~40ms), so only call this when the host has asked for it
+ * returns false if the erase or any of the writes failed */
+bool Store_Page_To_Flash(uint32_t PageAddress, uint8_t *pData, uint16_t wdLength)
+{
+    FLASH_EraseInitTypeDef EraseInit;
+    uint32_t PageError = 0;
+    uint16_t halfword;
+    bool     status = true;
+
+    while(READ_BIT(FLASH->SR, FLASH_SR_BSY) != RESET);  // wait for any flash operations to stop
+
+    HAL_FLASH_Unlock();
+
+    EraseInit.TypeErase   = FLASH_TYPEERASE_PAGES;
+    EraseInit.PageAddress = PageAddress;
+    EraseInit.NbPages     = 1;
+
+    if(HAL_FLASHEx_Erase(&EraseInit, &PageError) != HAL_OK)
+    {
+        status = false;
+    }
+
+    // flash is written a halfword at a time, an odd last byte is padded with the erased value
+    for(uint16_t i = 0; (status == true) && (i < wdLength); i += 2)
+    {
+        halfword = pData[i];
+        halfword |= ((i + 1) < wdLength) ? ((uint16_t)pData[i + 1] << 8) : 0xFF00;
+
+        if(HAL_FLASH_Program(FLASH_TYPEPROGRAM_HALFWORD, PageAddress + i, halfword) != HAL_OK)
+        {
+            status = false;
+        }
+    }
+
+    /* lock memory again to prevent any accidental writes! */
+    HAL_FLASH_Lock();
+
+    return status;
+}
+
+/*-----------------------------------------------------------*/
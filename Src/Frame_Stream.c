@@ -0,0 +1,471 @@
+/*******************************************************************************
+* @file           : Frame_Stream.c
+* @author         : agent
+* @date           : 18 Oct 2026
+*******************************************************************************/
+
+/*
+******************************************************************************
+* Copyright (c) 2026 TouchNetix
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+******************************************************************************
+*/
+
+/*============ Includes ============*/
+#include "stm32f0xx.h"
+#include "stm32f0xx_hal.h"
+#include <string.h>
+#include <stdbool.h>
+#include "Frame_Stream.h"
+#include "Comms.h"
+#include "Proxy_driver.h"
+#include "Scheduler.h"
+
+/*============ Defines ============*/
+#define READ                    (0x80u)
+#define RLE_MAX_RUN             (128U)
+#define RLE_MIN_RUN             (3U)    // shorter repeats are cheaper left in a literal
+#define ENCODED_CHUNK           (FRAME_ENCODED_MAX_DATA - 2)    // worst case this encodes to chunk + 1 bytes, so it always fits in an empty packet
+
+/*============ Local Structures ============*/
+struct framestream_st
+{
+    uint8_t  trigger;           // FRAME_TRIGGER_xxx
+    uint16_t start_address;
+    uint16_t length;            // bytes per frame
+    uint16_t page_length;       // usage page length, reads are split where they'd run past the end of a page
+    uint16_t interval;          // n reports or n ms, depending on the trigger
+    uint16_t counter;           // reports since the last frame
+    uint32_t last_trigger_ms;
+    uint16_t trigger_count;     // frame no. of the most recent trigger
+    uint16_t frame_number;      // frame no. being sent
+    uint16_t offset;            // bytes of the current frame already read
+    bool     boFrameInProgress;
+    uint16_t skipped;           // triggers that came along while a frame was still being sent
+    uint8_t  encoding;          // FRAME_ENCODING_xxx
+    uint8_t  key_interval;      // frames between key frames
+    uint8_t  frames_since_key;
+    bool     boKeyFrame;        // current frame is being sent as a key frame
+    bool     boNeedKeyFrame;    // host's copy of the previous frame can't be trusted (start, length change, read error)
+};
+
+// encoded packet being filled
+struct encodedpacket_st
+{
+    uint8_t  packet[64];
+    uint8_t  length;            // encoded bytes so far
+    uint16_t end_offset;        // frame offset the packet decodes up to
+};
+
+/*============ Local Variables ============*/
+struct framestream_st frame_stream = {.key_interval = DEFAULT_KEY_FRAME_INTERVAL};
+struct encodedpacket_st encoded_packet = {0};
+uint8_t previous_frame[MAX_ENCODED_FRAME_BYTES];
+
+/*============ Local Function Prototypes ============*/
+static void TriggerFrame(void);
+static void ReadChunk(uint16_t wdChunk);
+static void StartEncodedPacket(uint8_t byStatus);
+static bool FlushEncodedPacket(bool boEndOfFrame);
+static uint8_t EncodeRuns(uint8_t *pResidual, uint8_t byLength);
+
+/*============ Local Functions ============*/
+
+static void TriggerFrame(void)
+{
+    frame_stream.trigger_count++;
+
+    if(frame_stream.boFrameInProgress)
+    {
+        frame_stream.skipped++;
+        return;
+    }
+
+    frame_stream.frame_number      = frame_stream.trigger_count;
+    frame_stream.offset            = 0;
+    frame_stream.boFrameInProgress = true;
+
+    if(frame_stream.encoding == FRAME_ENCODING_XOR_RLE)
+    {
+        frame_stream.boKeyFrame = (frame_stream.boNeedKeyFrame || (frame_stream.frames_since_key >= frame_stream.key_interval));
+        frame_stream.frames_since_key = (frame_stream.boKeyFrame) ? 0 : (frame_stream.frames_since_key + 1);
+        frame_stream.boNeedKeyFrame = false;
+        StartEncodedPacket(COMMS_OK);
+    }
+
+    Scheduler_PostEvent(TASK_FRAME_STREAM);
+}
+
+/*-----------------------------------------------------------*/
+
+// reads the next piece of the frame - it ends up in the ring slot at the head (data from byte 2)
+static void ReadChunk(uint16_t wdChunk)
+{
+    uint16_t wdPage           = frame_stream.offset / frame_stream.page_length;
+    uint16_t wdOffsetIntoPage = frame_stream.offset % frame_stream.page_length;
+    uint16_t wdAddress        = frame_stream.start_address + (wdPage << 8) + wdOffsetIntoPage;
+
+    aXiom_Tx_Buffer[0] = (uint8_t)(wdAddress & 0xFF);
+    aXiom_Tx_Buffer[1] = (uint8_t)(wdAddress >> 8);
+    aXiom_Tx_Buffer[2] = (uint8_t)wdChunk;
+    aXiom_Tx_Buffer[3] = READ;
+    aXiom_NumBytesTx = 4;
+    aXiom_NumBytesRx = wdChunk;
+
+    (void)Comms_Sequence();
+}
+
+/*-----------------------------------------------------------*/
+
+static void StartEncodedPacket(uint8_t byStatus)
+{
+    memset(encoded_packet.packet, 0, sizeof(encoded_packet.packet));
+    encoded_packet.packet[0] = FRAME_STREAM_ENCODED_FLAG;
+    encoded_packet.packet[1] = byStatus;
+    encoded_packet.packet[2] = (uint8_t)(frame_stream.frame_number & 0xFF);
+    encoded_packet.packet[3] = (uint8_t)(frame_stream.frame_number >> 8);
+    encoded_packet.packet[4] = (uint8_t)(frame_stream.offset & 0xFF);
+    encoded_packet.packet[5] = (uint8_t)(frame_stream.offset >> 8);
+    encoded_packet.length     = 0;
+    encoded_packet.end_offset = frame_stream.offset;
+}
+
+/*-----------------------------------------------------------*/
+
+/* copies the packet into the ring and starts the next one where it left off
+ * returns false if the ring was full - the caller only flushes once per FrameStream_ReadNext() and checks for room first, so that
+ * means the frame can't be finished */
+static bool FlushEncodedPacket(bool boEndOfFrame)
+{
+    bool boPushed;
+
+    encoded_packet.packet[6] = encoded_packet.length;
+    encoded_packet.packet[7] = ((frame_stream.boKeyFrame) ? FRAME_ENCODED_KEY : 0) | ((boEndOfFrame) ? FRAME_ENCODED_END : 0);
+
+    memcpy(aXiom_Rx_Buffer[CircularBufferHead], encoded_packet.packet, sizeof(encoded_packet.packet));
+    boPushed = CircularBuffer_Push();
+    Scheduler_PostEvent(TASK_USB_IN);
+
+    encoded_packet.packet[4] = (uint8_t)(encoded_packet.end_offset & 0xFF);
+    encoded_packet.packet[5] = (uint8_t)(encoded_packet.end_offset >> 8);
+    memset(&encoded_packet.packet[FRAME_ENCODED_HEADER_BYTES], 0, FRAME_ENCODED_MAX_DATA);
+    encoded_packet.length = 0;
+
+    return boPushed;
+}
+
+/*-----------------------------------------------------------*/
+
+/* run-length encodes as much of pResidual as fits in the current packet, returns how many bytes were used
+ * the difference between two frames is mostly zeros, so long runs are the common case */
+static uint8_t EncodeRuns(uint8_t *pResidual, uint8_t byLength)
+{
+    uint8_t *pOut = &encoded_packet.packet[FRAME_ENCODED_HEADER_BYTES];
+    uint8_t byUsed = 0;
+    uint8_t byRun;
+    uint8_t byLiteral;
+
+    while(byUsed < byLength)
+    {
+        // length of the repeat starting here
+        byRun = 1;
+        while(((byUsed + byRun) < byLength) && (byRun < RLE_MAX_RUN) && (pResidual[byUsed + byRun] == pResidual[byUsed]))
+        {
+            byRun++;
+        }
+
+        if(byRun >= RLE_MIN_RUN)
+        {
+            if((encoded_packet.length + 2) > FRAME_ENCODED_MAX_DATA)
+            {
+                break;
+            }
+            pOut[encoded_packet.length++] = 0x80 | (byRun - 1);
+            pOut[encoded_packet.length++] = pResidual[byUsed];
+            byUsed += byRun;
+        }
+        else
+        {
+            // literal runs up to the next repeat worth encoding (or as far as there's room for)
+            if((encoded_packet.length + 2) > FRAME_ENCODED_MAX_DATA)
+            {
+                break;
+            }
+
+            byLiteral = 1;
+            while(((byUsed + byLiteral) < byLength) && (byLiteral < RLE_MAX_RUN) && ((encoded_packet.length + 1 + byLiteral) < FRAME_ENCODED_MAX_DATA))
+            {
+                if(((byUsed + byLiteral + RLE_MIN_RUN) <= byLength) &&
+                   (pResidual[byUsed + byLiteral] == pResidual[byUsed + byLiteral + 1]) &&
+                   (pResidual[byUsed + byLiteral] == pResidual[byUsed + byLiteral + 2]))
+                {
+                    break;
+                }
+                byLiteral++;
+            }
+
+            pOut[encoded_packet.length++] = byLiteral - 1;
+            memcpy(&pOut[encoded_packet.length], &pResidual[byUsed], byLiteral);
+            encoded_packet.length += byLiteral;
+            byUsed += byLiteral;
+        }
+    }
+
+    encoded_packet.end_offset += byUsed;
+
+    return byUsed;
+}
+
+/*============ Exported Functions ============*/
+
+// returns false if the settings don't make sense (nothing is changed)
+bool FrameStream_Start(uint8_t byTrigger, uint16_t wdAddress, uint16_t wdLength, uint8_t byPageLength, uint16_t wdInterval)
+{
+    if((byTrigger > FRAME_TRIGGER_PERIODIC) || (wdLength == 0) ||
+       (((byTrigger == FRAME_TRIGGER_EVERY_N) || (byTrigger == FRAME_TRIGGER_PERIODIC)) && (wdInterval == 0)))
+    {
+        return false;
+    }
+
+    if((frame_stream.encoding == FRAME_ENCODING_XOR_RLE) && (wdLength > MAX_ENCODED_FRAME_BYTES))
+    {
+        return false;
+    }
+
+    // encoding settings are kept, everything else starts again
+    frame_stream.counter           = 0;
+    frame_stream.trigger_count     = 0;
+    frame_stream.frame_number      = 0;
+    frame_stream.offset            = 0;
+    frame_stream.boFrameInProgress = false;
+    frame_stream.skipped           = 0;
+    frame_stream.frames_since_key  = 0;
+    frame_stream.boNeedKeyFrame    = true;
+    frame_stream.trigger         = byTrigger;
+    frame_stream.start_address   = wdAddress;
+    frame_stream.length          = wdLength;
+    frame_stream.page_length     = (byPageLength == 0) ? 256 : byPageLength;   // same as CMD_MULTIPAGE_READ
+    frame_stream.interval        = wdInterval;
+    frame_stream.last_trigger_ms = HAL_GetTick();
+
+    return true;
+}
+
+/*-----------------------------------------------------------*/
+
+// the skipped count is kept so the host can still read it after stopping
+void FrameStream_Stop(void)
+{
+    frame_stream.trigger           = FRAME_TRIGGER_OFF;
+    frame_stream.boFrameInProgress = false;
+}
+
+/*-----------------------------------------------------------*/
+
+uint16_t FrameStream_GetSkipped(void)
+{
+    return frame_stream.skipped;
+}
+
+/*-----------------------------------------------------------*/
+
+/* turns delta/RLE encoding on or off - a frame that doesn't fit in the previous frame buffer can't be encoded
+ * byKeyFrameInterval: a key frame (not relative to the previous one) is sent at least this often, 0 = DEFAULT_KEY_FRAME_INTERVAL */
+bool FrameStream_SetEncoding(uint8_t byEncoding, uint8_t byKeyFrameInterval)
+{
+    if((byEncoding > FRAME_ENCODING_XOR_RLE) || ((byEncoding == FRAME_ENCODING_XOR_RLE) && (frame_stream.length > MAX_ENCODED_FRAME_BYTES)))
+    {
+        return false;
+    }
+
+    frame_stream.encoding       = byEncoding;
+    frame_stream.key_interval   = (byKeyFrameInterval == 0) ? DEFAULT_KEY_FRAME_INTERVAL : byKeyFrameInterval;
+    frame_stream.boNeedKeyFrame = true;
+    frame_stream.boFrameInProgress = false;     // a frame half sent in the old encoding would confuse the host
+
+    return true;
+}
+
+/*-----------------------------------------------------------*/
+
+// called each time a report has been read off aXiom
+void FrameStream_ReportRead(void)
+{
+    if(frame_stream.trigger == FRAME_TRIGGER_EVERY_REPORT)
+    {
+        TriggerFrame();
+    }
+    else if(frame_stream.trigger == FRAME_TRIGGER_EVERY_N)
+    {
+        if(++frame_stream.counter >= frame_stream.interval)
+        {
+            frame_stream.counter = 0;
+            TriggerFrame();
+        }
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+// called every 1ms
+void FrameStream_Tick(void)
+{
+    if((frame_stream.trigger == FRAME_TRIGGER_PERIODIC) && ((HAL_GetTick() - frame_stream.last_trigger_ms) >= frame_stream.interval))
+    {
+        frame_stream.last_trigger_ms += frame_stream.interval;  // keeps the period steady even if this tick was late
+        TriggerFrame();
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+/* reads the next piece of the current frame into the ring, it's then sent by the USB IN task like any proxy report
+ * returns true if there's more of the frame to go straight away - false (frame still in progress) while waiting for room in the ring */
+bool FrameStream_ReadNext(void)
+{
+    uint8_t *pSlot;
+    uint16_t wdChunk;
+    uint16_t wdOffsetIntoPage;
+    uint8_t  byStatus;
+    uint8_t  raw[FRAME_STREAM_MAX_DATA];
+    uint8_t  byUsed;
+    bool     boFailed;
+    bool     boPushed;
+
+    if(frame_stream.boFrameInProgress == false)
+    {
+        return false;
+    }
+
+    /* a multi-page read relies on aXiom_Tx_Buffer staying put between reads, and the ring has to have room for this packet
+     * each call puts at most one packet in the ring (the read lands in the free slot and is copied out before it's re-used), so on
+     * the F042 where the ring only has one usable slot an encoded frame still gets through */
+    if((ProxyMP_TotalNumBytesRx != 0) || CircularBuffer_IsFull())
+    {
+        return false;   // USBInTask posts this again once a slot is freed, BlockReadTask once the multi-page read is done
+    }
+
+    // the whole frame has been read, but its last chunk spilled into a 2nd packet - that's sent on its own call
+    if((frame_stream.encoding == FRAME_ENCODING_XOR_RLE) && (frame_stream.offset >= frame_stream.length))
+    {
+        if(FlushEncodedPacket(true) == false)
+        {
+            frame_stream.boNeedKeyFrame = true;
+        }
+        frame_stream.boFrameInProgress = false;
+        return false;
+    }
+
+    wdOffsetIntoPage = frame_stream.offset % frame_stream.page_length;
+    wdChunk = frame_stream.length - frame_stream.offset;
+    if(wdChunk > ((frame_stream.encoding == FRAME_ENCODING_XOR_RLE) ? ENCODED_CHUNK : FRAME_STREAM_MAX_DATA))
+    {
+        wdChunk = (frame_stream.encoding == FRAME_ENCODING_XOR_RLE) ? ENCODED_CHUNK : FRAME_STREAM_MAX_DATA;
+    }
+    if(wdChunk > (frame_stream.page_length - wdOffsetIntoPage))
+    {
+        wdChunk = frame_stream.page_length - wdOffsetIntoPage;
+    }
+
+    ReadChunk(wdChunk);
+
+    pSlot    = aXiom_Rx_Buffer[CircularBufferHead];
+    byStatus = pSlot[0];
+    boFailed = ((byStatus != COMMS_OK) && (byStatus != COMMS_OK_NO_READ));
+
+    if(frame_stream.encoding == FRAME_ENCODING_XOR_RLE)
+    {
+        if(boFailed)
+        {
+            // host throws the frame away when it sees the status, and the next frame can't be relative to this one
+            encoded_packet.packet[1] = byStatus;
+            (void)FlushEncodedPacket(true);     // nothing more to do if it doesn't go in, the host won't see the end of the frame either way
+            frame_stream.boNeedKeyFrame = true;
+            frame_stream.boFrameInProgress = false;
+            return false;
+        }
+
+        // difference from the previous frame (or the frame itself for a key frame) - the frame read is kept for next time
+        memcpy(raw, &pSlot[2], wdChunk);
+        for(uint8_t i = 0; i < wdChunk; i++)
+        {
+            uint8_t byPrevious = previous_frame[frame_stream.offset + i];
+
+            previous_frame[frame_stream.offset + i] = raw[i];
+            if(frame_stream.boKeyFrame == false)
+            {
+                raw[i] ^= byPrevious;
+            }
+        }
+
+        boPushed = false;
+        byUsed = EncodeRuns(raw, wdChunk);
+        if(byUsed < wdChunk)
+        {
+            if(FlushEncodedPacket(false) == false)
+            {
+                // a packet's missing, so the host can't decode the rest of this frame and the next can't be relative to it
+                frame_stream.boNeedKeyFrame = true;
+                frame_stream.boFrameInProgress = false;
+                return false;
+            }
+            boPushed = true;
+            (void)EncodeRuns(&raw[byUsed], wdChunk - byUsed);    // always fits in an empty packet
+        }
+
+        frame_stream.offset += wdChunk;
+        if((frame_stream.offset >= frame_stream.length) && (boPushed == false))
+        {
+            if(FlushEncodedPacket(true) == false)
+            {
+                frame_stream.boNeedKeyFrame = true;
+            }
+            frame_stream.boFrameInProgress = false;
+        }
+
+        return frame_stream.boFrameInProgress;
+    }
+
+    memmove(&pSlot[FRAME_STREAM_HEADER_BYTES], &pSlot[2], wdChunk);
+    memset(&pSlot[FRAME_STREAM_HEADER_BYTES + wdChunk], 0, FRAME_STREAM_MAX_DATA - wdChunk);
+    pSlot[0] = FRAME_STREAM_FLAG;
+    pSlot[1] = byStatus;
+    pSlot[2] = (uint8_t)(frame_stream.frame_number & 0xFF);
+    pSlot[3] = (uint8_t)(frame_stream.frame_number >> 8);
+    pSlot[4] = (uint8_t)(frame_stream.offset & 0xFF);
+    pSlot[5] = (uint8_t)(frame_stream.offset >> 8);
+    if(CircularBuffer_Push() == false)
+    {
+        // can't happen, room was checked above - but if it does the rest of the frame is no use to the host
+        frame_stream.boFrameInProgress = false;
+        return false;
+    }
+    Scheduler_PostEvent(TASK_USB_IN);
+
+    frame_stream.offset += wdChunk;
+
+    // the rest of a frame that's failed to read is no use, the host will see the comms status and wait for the next one
+    if((frame_stream.offset >= frame_stream.length) || boFailed)
+    {
+        frame_stream.boFrameInProgress = false;
+    }
+
+    return frame_stream.boFrameInProgress;
+}
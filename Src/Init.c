@@ -45,6 +45,7 @@
 #include "Proxy_driver.h"
 #include "Flash_Control.h"
 #include "Digitizer.h"
+#include "Timers_and_LEDs.h"
 
 /*============ Defines ============*/
 #define USAGETABLE_MAX_RETRY_NUM    (250U)
@@ -58,12 +59,17 @@ I2C_HandleTypeDef hi2c_module;
 DMA_HandleTypeDef hdma_spi_tx;
 DMA_HandleTypeDef hdma_spi_rx;
 TIM_HandleTypeDef htim16;
+TIM_HandleTypeDef htim17;
 
 /*============ Local Function Declarations ============*/
 static  uint8_t check_comms_mode(void);
 static  void    MX_GPIO_Init(void);
 static  void    MX_DMA_Init(void);
 static  void    MX_TIM16_Init(void);
+static  void    MX_TIM17_Init(void);
+#if defined(STM32F072xB)
+static  void    MX_CRC_Init(void);
+#endif
 static  void    LEDs_Init(void);
 static  bool    detect_host_presence(void);
 static  void    Reset_Device(void);
@@ -141,8 +147,12 @@ void Device_Init(void)
 
     /* Initialize the rest of the peripherals */
     MX_TIM16_Init();
+    MX_TIM17_Init();
     MX_GPIO_Init();
     MX_DMA_Init();
+#if defined(STM32F072xB)
+    MX_CRC_Init();
+#endif
     LEDs_Init();
 
     HAL_GPIO_TogglePin(LED_AXIOM_GPIO_Port, LED_AXIOM_Pin);
@@ -199,10 +209,9 @@ void Device_Init(void)
     HAL_GPIO_WritePin(LED_AXIOM_GPIO_Port, LED_AXIOM_Pin, GPIO_PIN_RESET);
     HAL_GPIO_WritePin(LED_USB_GPIO_Port, LED_USB_Pin, GPIO_PIN_RESET);
 
-    if(BridgeMode == PARALLEL_DIGITIZER) // set comms parameters for device to work in digitizer mode (noone else to set these!)
-    {
-        HAL_TIM_Base_Start_IT(&htim16); // starts the timer used for digitizer timestamps
-    }
+    HAL_TIM_Base_Start(&htim16); // free-running counter (no interrupt, read on demand) - digitizer, proxy report and watch list timestamps all use it, whatever the mode
+
+    HAL_TIM_Base_Start_IT(&htim17); // LED flash and heartbeat timing from here on
 
     InitProxyInterruptMode();   // sets pin PA0 as EXTI interrupt --> this means the bridge will always enter proxy mode at startup (digitizer or not)
 
@@ -481,9 +490,9 @@ static void MX_TIM16_Init(void)
 
     /* USER CODE END TIM16_Init 1 */
     htim16.Instance = TIM16;
-    htim16.Init.Prescaler = SYSTEMCLOCK_IN_MHZ - 1;
+    htim16.Init.Prescaler = (SYSTEMCLOCK_IN_MHZ * 100) - 1;  // counter ticks every 100us
     htim16.Init.CounterMode = TIM_COUNTERMODE_UP;
-    htim16.Init.Period = 100 - 1; // want a period of 100us
+    htim16.Init.Period = 0xFFFF; // free-running, wraps like the 16-bit timestamp Windows expects
     htim16.Init.ClockDivision = TIM_CLOCKDIVISION_DIV1;
     htim16.Init.RepetitionCounter = 0;
     htim16.Init.AutoReloadPreload = TIM_AUTORELOAD_PRELOAD_DISABLE;
@@ -498,6 +507,42 @@ static void MX_TIM16_Init(void)
 
 //--------------------------
 
+// LED tick --> lowest priority interrupt every LED_TICK_MS, drives activity flashes and the heartbeat
+static void MX_TIM17_Init(void)
+{
+    htim17.Instance = TIM17;
+    htim17.Init.Prescaler = (SYSTEMCLOCK_IN_MHZ * 100) - 1;  // counter ticks every 100us
+    htim17.Init.CounterMode = TIM_COUNTERMODE_UP;
+    htim17.Init.Period = (LED_TICK_MS * 10) - 1;
+    htim17.Init.ClockDivision = TIM_CLOCKDIVISION_DIV1;
+    htim17.Init.RepetitionCounter = 0;
+    htim17.Init.AutoReloadPreload = TIM_AUTORELOAD_PRELOAD_DISABLE;
+    if (HAL_TIM_Base_Init(&htim17) != HAL_OK)
+    {
+      Error_Handler();
+    }
+}
+
+//--------------------------
+
+#if defined(STM32F072xB)
+// F072 CRC unit has a programmable polynomial so it can do the u34 report CRC (CRC16-IBM, 0x8005, reflected in and out, seed 0)
+// F042/F070 only have the fixed 32-bit polynomial so they stick with the look-up table
+static void MX_CRC_Init(void)
+{
+    __HAL_RCC_CRC_CLK_ENABLE();
+
+    CRC->POL  = 0x8005;
+    CRC->INIT = 0x0000;
+    CRC->CR   = CRC_CR_POLYSIZE_0       // 16-bit polynomial
+              | CRC_CR_REV_IN_0         // bit reversal done by byte
+              | CRC_CR_REV_OUT          // reversed output
+              | CRC_CR_RESET;
+}
+#endif
+
+//--------------------------
+
 // sends a reset signal to the connected device (aXiom)
 static void Reset_Device(void)
 {
@@ -137,7 +137,8 @@ void Device_DeInit(void)
     USBD_DeInit(&hUsbDeviceFS);
     HAL_Delay(3000);
 
-    HAL_TIM_Base_Stop_IT(&htim16);
+    HAL_TIM_Base_Stop(&htim16);
+    HAL_TIM_Base_Stop_IT(&htim17);
 
     // Only deinit the comms module in use as the
     // pointer to other will be NULL and will result in a hardfault
@@ -157,6 +158,7 @@ void Device_DeInit(void)
     }
 
     HAL_TIM_Base_MspDeInit(&htim16);
+    HAL_TIM_Base_MspDeInit(&htim17);
     HAL_GPIO_DeInit(LED_USB_GPIO_Port, LED_USB_Pin);
     HAL_GPIO_DeInit(LED_AXIOM_GPIO_Port, LED_AXIOM_Pin);
     HAL_DeInit();
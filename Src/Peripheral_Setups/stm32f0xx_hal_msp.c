@@ -236,10 +236,14 @@ void HAL_TIM_Base_MspInit(TIM_HandleTypeDef* htim_base)
     /* Peripheral clock enable */
     __HAL_RCC_TIM16_CLK_ENABLE();
   /* USER CODE BEGIN TIM16_MspInit 1 */
-    HAL_NVIC_SetPriority(TIM16_IRQn, 0, 0);
-    HAL_NVIC_EnableIRQ(TIM16_IRQn);
   /* USER CODE END TIM16_MspInit 1 */
   }
+  else if(htim_base->Instance==TIM17)
+  {
+    __HAL_RCC_TIM17_CLK_ENABLE();
+    HAL_NVIC_SetPriority(TIM17_IRQn, 3, 0);   // LEDs only, anything else can pre-empt it
+    HAL_NVIC_EnableIRQ(TIM17_IRQn);
+  }
 }
 
 /**
@@ -258,9 +262,13 @@ void HAL_TIM_Base_MspDeInit(TIM_HandleTypeDef* htim_base)
     /* Peripheral clock disable */
     __HAL_RCC_TIM16_CLK_DISABLE();
   /* USER CODE BEGIN TIM16_MspDeInit 1 */
-    HAL_NVIC_DisableIRQ(TIM16_IRQn);
   /* USER CODE END TIM16_MspDeInit 1 */
   }
+  else if(htim_base->Instance==TIM17)
+  {
+    __HAL_RCC_TIM17_CLK_DISABLE();
+    HAL_NVIC_DisableIRQ(TIM17_IRQn);
+  }
 }
 
 /* USER CODE BEGIN 1 */
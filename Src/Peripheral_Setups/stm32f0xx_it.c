@@ -25,6 +25,7 @@
 #include "Proxy_driver.h"
 #include "Digitizer.h"
 #include "Init.h"
+#include "Scheduler.h"
 
 /* Private includes ----------------------------------------------------------*/
 /* USER CODE BEGIN Includes */
@@ -146,6 +147,7 @@ void SysTick_Handler(void)
   HAL_IncTick();
 
   /* USER CODE BEGIN SysTick_IRQn 1 */
+    Scheduler_PostEvent(TASK_HOUSEKEEPING);
 
   /* USER CODE END SysTick_IRQn 1 */
 }
@@ -203,11 +205,19 @@ void I2C1_IRQHandler(void)
 }
 
 /**
-  * @brief This function handles TIM1 update interrupt and TIM16 global interrupt.
+  * @brief This function handles EXTI line 0 and 1 interrupts (nIRQ from aXiom).
   */
-void TIM16_IRQHandler(void)
+void EXTI0_1_IRQHandler(void)
 {
-    HAL_TIM_IRQHandler(&htim16);
+    HAL_GPIO_EXTI_IRQHandler(nIRQ_Pin);
+}
+
+/**
+  * @brief This function handles TIM17 global interrupt (LED tick).
+  */
+void TIM17_IRQHandler(void)
+{
+    HAL_TIM_IRQHandler(&htim17);
 }
 
 /* USER CODE END 1 */
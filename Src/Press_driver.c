@@ -36,6 +36,7 @@
 #include "Mode_Control.h"
 #include "Digitizer.h"
 #include "usbd_press_if.h"
+#include "Report_Queue.h"
 
 /*============ Defines ============*/
 #define NOT_USED                        (0x00)
@@ -77,7 +78,7 @@ static void BuildPressReport(void)
     usb_hid_press_report_in[ByteCount++] = byNumTouches;  // payload
     usb_hid_press_report_in[ByteCount++] = NOT_USED;  // empty
 
-    // Touch XYZ data
+    // Touch XYZ data - only the first 5 contacts fit in the report, the total above still counts all of them
     for(TouchIdx = 1; TouchIdx <= 5; TouchIdx++)
     {
         usb_hid_press_report_in[ByteCount++] = (PAYLOADLENGTH_TOUCHXYDATA << 3 ) | IDFIELD_TOUCHXYDATA; // ID Field
@@ -125,7 +126,7 @@ void BuildPressReportFromPressAndTouch(void)
         {
             BuildPressReport();
             boDoPressEvent = 0;
-            boPressReportToSend = 1; // send a press report
+            (void)ReportQueue_Push(&press_report_queue, usb_hid_press_report_in, USBD_PRESS_HID_REPORT_IN_SIZE, true); // send a press report
         }
     }
 }
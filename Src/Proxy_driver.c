@@ -41,6 +41,7 @@
 #include "Digitizer.h"
 #include "Mode_Control.h"
 #include "Usage_Builder.h"
+#include "Scheduler.h"
 
 /*============ Defines ============*/
 #define NO_DATA        (0)
@@ -49,14 +50,26 @@
 #define INTERRUPT   (0x03) // waits for connected device to pull nIRQ line low --> indicates report available
 #define READ        (0x80)
 #define PROXY_FLAG  (0x9Au) // "magic flag" for repeat proxy data
+#define PROXY_PACKED_FLAG       (0x9Bu) // "magic flag" for a packet holding several proxy reports
+#define PROXY_HEADER_BYTES      (2)     // flag + comms status (or no. reports when packed)
+#define MAX_PROXY_REPORT_BYTES  (USBD_GENERIC_HID_REPORT_IN_SIZE - PROXY_HEADER_BYTES)
+#define U34_USAGE_ID_BYTE       (1)     // u34 report: [0] length, [1] usage number of the report (e.g. 0x41 for touch)
 
 /*============ Local Variables ============*/
+uint8_t packed_proxy_report[USBD_GENERIC_HID_REPORT_IN_SIZE] = {0};
+struct proxyfilter_st proxy_filter[MAX_PROXY_FILTER_ENTRIES] = {0};
+uint8_t byNumProxyFilterEntries = 0;    // 0 = no filter, every report is forwarded
+volatile uint16_t wdnIRQEdgeTimestamp   = 0;    // TIM16 count latched on the nIRQ falling edge
+volatile bool     bonIRQEdgeLatched     = 0;    // set by the EXTI callback, cleared once the report has been read
 
 /*============ Exported Variables ============*/
 volatile bool boProxyReportAvailable    = 0;    // indicates aXiom has a report ready
 bool    boProxyEnabled                  = 0;    // does what is says on the tin really
 bool    boProxyReportToProcess          = 0;    // status flag if the report has been read off aXiom yet
 bool    boInternalProxy                 = 0;    // flag to say whether proxy mode has been triggered internally or by the host --> reports shouldn't come out of the generic endpoint unless proxy requested by host!
+bool    boProxyPackedFraming            = 0;    // host has asked for several reports to be packed into each generic packet when they're queued up
+uint16_t wdReportTimestamp              = 0;    // 100us timestamp of when the last proxy report became available on aXiom
+bool    boProxyInterruptReady           = 0;    // nIRQ is set up as EXTI - once de-initialised the pin is analog and always reads 0, so it can't be polled
 
 //-------------- Multipage Read --------------
 bool     boReadInProgress           = 0;    // indicates whether we're already doing a read (prevents parameters being set again)
@@ -66,9 +79,27 @@ uint16_t wdProxyMP_AddrStart        = 0;    // multi-page start target address
 uint16_t wdProxyMP_BytesRead        = 0;    // variable keeps track of how many bytes in we are
 
 /*============ Local Function Prototypes ============*/
+static uint8_t GetProxyReportLength(uint8_t *pSlot);
 
 /*============ Local Functions ============*/
 
+// returns the no. bytes of the u34 report held in a ring slot (length field counts 16-bit words, CRC included), 0 if the slot isn't a proxy report
+static uint8_t GetProxyReportLength(uint8_t *pSlot)
+{
+    uint8_t byLength;
+
+    if((pSlot[0] != PROXY_FLAG) || (pSlot[1] != COMMS_OK))
+    {
+        return 0;
+    }
+
+    byLength = (pSlot[PROXY_HEADER_BYTES] & 0x7F) * 2;
+
+    return (byLength > MAX_PROXY_REPORT_BYTES) ? MAX_PROXY_REPORT_BYTES : byLength;
+}
+
+/*-----------------------------------------------------------*/
+
 /*============ Exported Functions ============*/
 void InitProxyInterruptMode(void)
 {
@@ -76,9 +107,15 @@ void InitProxyInterruptMode(void)
 
     /* Configure GPIO pin: nIRQ_Pin --> GPIOA0 */
     GPIO_InitStruct.Pin  = nIRQ_Pin;
-    GPIO_InitStruct.Mode = GPIO_MODE_INPUT;
+    GPIO_InitStruct.Mode = GPIO_MODE_IT_FALLING;    // pin level is still polled by the main loop, the edge is only used to timestamp the report
     GPIO_InitStruct.Pull = GPIO_NOPULL;
     HAL_GPIO_Init(nIRQ_GPIO_Port, &GPIO_InitStruct);
+
+    bonIRQEdgeLatched = 0;
+    HAL_NVIC_SetPriority(EXTI0_1_IRQn, 0, 0);
+    HAL_NVIC_EnableIRQ(EXTI0_1_IRQn);
+
+    boProxyInterruptReady = 1;
 }
 
 /*-----------------------------------------------------------*/
@@ -86,9 +123,26 @@ void InitProxyInterruptMode(void)
 /* De-initialise GPIO pin: nIRQ_Pin --> GPIOA 0 */
 void DeInitProxyInterruptMode(void)
 {
+    boProxyInterruptReady = 0;
+
+    HAL_NVIC_DisableIRQ(EXTI0_1_IRQn);
     HAL_GPIO_DeInit(GPIOA, nIRQ_Pin);
 }
 
+/*-----------------------------------------------------------*/
+
+// callback from EXTI0_1_IRQHandler --> latches the free-running 100us counter when aXiom pulls nIRQ low and wakes the proxy read task
+void HAL_GPIO_EXTI_Callback(uint16_t GPIO_Pin)
+{
+    if((GPIO_Pin == nIRQ_Pin) && (bonIRQEdgeLatched == 0))
+    {
+        wdnIRQEdgeTimestamp = (uint16_t)__HAL_TIM_GET_COUNTER(&htim16);
+        bonIRQEdgeLatched = 1;
+    }
+
+    Scheduler_PostEvent(TASK_PROXY_READ);
+}
+
 /*-----------------------------------------------------------*/
 /* @brief: Controls the operation of autonomously reading and reporting touch reports from connected device
  * @param: boMultiPageRead if doing a block read (3D drawing) this is true, allows re-use of this function
@@ -117,6 +171,10 @@ bool ProxyExecute(bool boMultiPageRead)
                 aXiom_Tx_Buffer[1] = (u34_addr & 0xFF00) >> 8;  // page address of u34
                 aXiom_Tx_Buffer[2] = NUMPROXYBYTES_RX;          // proxy mode so hard code to read 64 bytes
                 aXiom_Tx_Buffer[3] = 0x00 | READ;
+
+                // nIRQ stays low when aXiom has several reports queued, so there's only an edge for the first - the rest are stamped as they're read
+                wdReportTimestamp = (bonIRQEdgeLatched == 1) ? wdnIRQEdgeTimestamp : (uint16_t)__HAL_TIM_GET_COUNTER(&htim16);
+                bonIRQEdgeLatched = 0;
             }
             else if(boMultiPageRead == true)
             {
@@ -126,6 +184,8 @@ bool ProxyExecute(bool boMultiPageRead)
 
             if(Comms_Sequence() == HAL_OK)
             {
+                boProxyReportToProcess = 1;  // only a proxy read flags a report - other callers of Comms_Sequence() leave this alone
+
                 // If doing a multi-page read we don't want to copy read data to report buffer
                 if(boMultiPageRead == true)
                 {
@@ -164,3 +224,125 @@ bool ProxyExecute(bool boMultiPageRead)
 
     return status;
 }
+
+/*-----------------------------------------------------------*/
+/* @brief: Sets up the list of report usages forwarded to the host in proxy mode
+ * @param: pFilter list of (usage number, decimation) pairs, decimation of 0 or 1 forwards every report, n forwards 1 in every n
+ * @param: byNumEntries no. pairs in list, 0 turns the filter off
+ * @retval: false if the list is too long
+ */
+bool SetProxyReportFilter(uint8_t *pFilter, uint8_t byNumEntries)
+{
+    if(byNumEntries > MAX_PROXY_FILTER_ENTRIES)
+    {
+        return false;
+    }
+
+    for(uint8_t i = 0; i < byNumEntries; i++)
+    {
+        proxy_filter[i].usagenum   = pFilter[(i * 2) + 0];
+        proxy_filter[i].decimation = pFilter[(i * 2) + 1];
+        proxy_filter[i].counter    = 0;
+    }
+
+    byNumProxyFilterEntries = byNumEntries;
+
+    return true;
+}
+
+/*-----------------------------------------------------------*/
+
+// checks the report just read (in the slot at the head of the ring) against the host's filter --> false means it should be thrown away
+bool ProxyReportWanted(void)
+{
+    uint8_t byUsage = aXiom_Rx_Buffer[CircularBufferHead][PROXY_HEADER_BYTES + U34_USAGE_ID_BYTE];
+
+    if(byNumProxyFilterEntries == 0)
+    {
+        return true;
+    }
+
+    for(uint8_t i = 0; i < byNumProxyFilterEntries; i++)
+    {
+        if(proxy_filter[i].usagenum == byUsage)
+        {
+            if(proxy_filter[i].decimation <= 1)
+            {
+                return true;
+            }
+
+            // only forward 1 in every 'decimation' reports of this type
+            proxy_filter[i].counter++;
+            if(proxy_filter[i].counter >= proxy_filter[i].decimation)
+            {
+                proxy_filter[i].counter = 0;
+                return true;
+            }
+
+            return false;
+        }
+    }
+
+    return false;   // not on the list
+}
+
+/*-----------------------------------------------------------*/
+/* @brief: Gets the next generic packet to send from the aXiom rx ring and releases the slots it used
+ * @param: none
+ * @retval: pointer to the packet to send, NULL if the ring is empty
+ *
+ * Packed framing (only when the host has turned it on and more than one report is waiting - never on the STM32F042x6, its 2 slot ring only holds 1):
+ *  0: PROXY_PACKED_FLAG
+ *  1: no. reports in packet
+ *  then for each report: length in bytes, report bytes (exactly as read from u34)
+ *  rest of packet is zero
+ */
+uint8_t *GetNextProxyPacket(void)
+{
+    uint8_t byReportLength;
+    uint8_t bySecondReportLength;
+    uint8_t byNextByte;
+
+    if(CircularBuffer_IsEmpty())
+    {
+        return NULL;
+    }
+
+    if((boProxyPackedFraming == false) || (CircularBuffer_Count() < 2))
+    {
+        // normal framing - send the slot as it is, the caller releases it once sent
+        return aXiom_Rx_Buffer[CircularBufferTail];
+    }
+
+    // only worth packing if at least the first 2 reports fit in one packet
+    byReportLength = GetProxyReportLength(aXiom_Rx_Buffer[CircularBufferTail]);
+    bySecondReportLength = GetProxyReportLength(aXiom_Rx_Buffer[(CircularBufferTail + 1) % MAX_NUM_RX_BUFFERS]);
+
+    if((byReportLength == 0) || (bySecondReportLength == 0) || ((PROXY_HEADER_BYTES + 1 + byReportLength + 1 + bySecondReportLength) > USBD_GENERIC_HID_REPORT_IN_SIZE))
+    {
+        return aXiom_Rx_Buffer[CircularBufferTail];
+    }
+
+    memset(packed_proxy_report, 0x00, sizeof(packed_proxy_report));
+    packed_proxy_report[0] = PROXY_PACKED_FLAG;
+    byNextByte = PROXY_HEADER_BYTES;
+
+    while(CircularBuffer_IsEmpty() == false)
+    {
+        byReportLength = GetProxyReportLength(aXiom_Rx_Buffer[CircularBufferTail]);
+
+        if((byReportLength == 0) || ((byNextByte + 1 + byReportLength) > USBD_GENERIC_HID_REPORT_IN_SIZE))
+        {
+            break;  // doesn't fit (or isn't a proxy report), it'll go in the next packet
+        }
+
+        packed_proxy_report[byNextByte++] = byReportLength;
+        memcpy(&packed_proxy_report[byNextByte], &aXiom_Rx_Buffer[CircularBufferTail][PROXY_HEADER_BYTES], byReportLength);
+        byNextByte += byReportLength;
+        packed_proxy_report[1]++;
+
+        CircularBuffer_Pop();
+    }
+
+    return packed_proxy_report;
+}
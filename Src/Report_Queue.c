@@ -0,0 +1,183 @@
+/*******************************************************************************
+* @file           : Report_Queue.c
+* @author         : agent
+* @date           : 18 Oct 2026
+*******************************************************************************/
+
+/*
+******************************************************************************
+* Copyright (c) 2026 TouchNetix
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+******************************************************************************
+*/
+
+/*============ Includes ============*/
+#include "stm32f0xx.h"
+#include "stm32f0xx_hal.h"
+#include <string.h>
+#include <stdbool.h>
+#include "Report_Queue.h"
+
+/*============ Defines ============*/
+#define MOUSE_QUEUE_MAX_AGE_MS      (50)    // a touch older than this is no use to the host, better to send the next one
+
+/*============ Local Variables ============*/
+
+/*============ Exported Variables ============*/
+// mouse endpoint keeps frames in order (hybrid digitizer frames span several packets) but won't send stale touches
+struct reportqueue_st mouse_report_queue = {.policy = QUEUE_MAX_AGE,     .max_age_ms = MOUSE_QUEUE_MAX_AGE_MS};
+// press endpoint only cares about the latest state - if the host is slow reading it, it shouldn't hold anything else up
+struct reportqueue_st press_report_queue = {.policy = QUEUE_LATEST_WINS, .max_age_ms = 0};
+
+/*============ Local Function Prototypes ============*/
+static void DropOldest(struct reportqueue_st *queue);
+static uint8_t DropOldestFrame(struct reportqueue_st *queue);
+
+/*============ Local Functions ============*/
+
+static void DropOldest(struct reportqueue_st *queue)
+{
+    queue->tail = (queue->tail + 1) % REPORT_QUEUE_DEPTH;
+    queue->count--;
+}
+
+/*-----------------------------------------------------------*/
+
+/* throws away the oldest report along with the rest of its frame, so the host is never sent the 2nd packet of a frame without the 1st
+ * returns the no. reports thrown away */
+static uint8_t DropOldestFrame(struct reportqueue_st *queue)
+{
+    uint8_t byDropped = 0;
+
+    do
+    {
+        DropOldest(queue);
+        byDropped++;
+    } while((queue->count > 0) && (queue->frame_start[queue->tail] == false));
+
+    return byDropped;
+}
+
+/*============ Exported Functions ============*/
+
+// adds a report to the queue, boNewFrame is false for the 2nd, 3rd... packets of a multi-packet frame so they aren't separated from the first
+// returns false if the report was dropped
+bool ReportQueue_Push(struct reportqueue_st *queue, uint8_t *report, uint8_t length, bool boNewFrame)
+{
+    if(length > REPORT_QUEUE_ENTRY_SIZE)
+    {
+        length = REPORT_QUEUE_ENTRY_SIZE;
+    }
+
+    // the rest of a frame that's already lost a packet is no use to the host
+    if(boNewFrame)
+    {
+        queue->boDroppingFrame = false;
+    }
+    else if(queue->boDroppingFrame)
+    {
+        queue->dropped++;
+        return false;
+    }
+
+    if((queue->policy == QUEUE_LATEST_WINS) && boNewFrame)
+    {
+        // anything still waiting is out of date now
+        queue->dropped += queue->count;
+        queue->head  = 0;
+        queue->tail  = 0;
+        queue->count = 0;
+    }
+
+    if(queue->count >= REPORT_QUEUE_DEPTH)
+    {
+        if(queue->policy == QUEUE_FIFO)
+        {
+            queue->dropped++;
+            queue->boDroppingFrame = true;
+            return false;
+        }
+        else
+        {
+            // make room by throwing away the oldest frame
+            queue->dropped += DropOldestFrame(queue);
+
+            if((boNewFrame == false) && (queue->count == 0))
+            {
+                // that was the start of this report's own frame
+                queue->dropped++;
+                queue->boDroppingFrame = true;
+                return false;
+            }
+        }
+    }
+
+    memcpy(queue->report[queue->head], report, length);
+    queue->length[queue->head]      = length;
+    queue->timestamp[queue->head]   = HAL_GetTick();
+    queue->frame_start[queue->head] = boNewFrame;
+
+    queue->head = (queue->head + 1) % REPORT_QUEUE_DEPTH;
+    queue->count++;
+
+    return true;
+}
+
+/*-----------------------------------------------------------*/
+
+// returns the oldest report still worth sending (or NULL if there isn't one), it stays in the queue until ReportQueue_Pop() is called
+uint8_t *ReportQueue_Peek(struct reportqueue_st *queue, uint8_t *length)
+{
+    if(queue->policy == QUEUE_MAX_AGE)
+    {
+        while((queue->count > 0) && ((HAL_GetTick() - queue->timestamp[queue->tail]) > queue->max_age_ms))
+        {
+            queue->aged_out += DropOldestFrame(queue);
+        }
+    }
+
+    if(queue->count == 0)
+    {
+        return NULL;
+    }
+
+    *length = queue->length[queue->tail];
+    return queue->report[queue->tail];
+}
+
+/*-----------------------------------------------------------*/
+
+void ReportQueue_Pop(struct reportqueue_st *queue)
+{
+    if(queue->count > 0)
+    {
+        DropOldest(queue);
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+void ReportQueue_Flush(struct reportqueue_st *queue)
+{
+    queue->head  = 0;
+    queue->tail  = 0;
+    queue->count = 0;
+    queue->boDroppingFrame = false;
+}
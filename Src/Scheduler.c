@@ -0,0 +1,174 @@
+/*******************************************************************************
+* @file           : Scheduler.c
+* @author         : agent
+* @date           : 18 Oct 2026
+*******************************************************************************/
+
+/*
+******************************************************************************
+* Copyright (c) 2026 TouchNetix
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+******************************************************************************
+*/
+
+/*============ Includes ============*/
+#include "stm32f0xx.h"
+#include "stm32f0xx_hal.h"
+#include <stddef.h>
+#include <stdbool.h>
+#include "Init.h"
+#include "Scheduler.h"
+
+/*============ Defines ============*/
+
+/*============ Local Variables ============*/
+volatile uint32_t pending_events = 0;   // bit n set = task n has something to do
+
+/*============ Exported Variables ============*/
+struct task_st scheduler_tasks[NUM_TASKS] = {0};
+
+/*============ Local Function Prototypes ============*/
+static uint8_t TakeHighestPriorityEvent(void);
+
+/*============ Local Functions ============*/
+
+// returns (and clears) the highest priority pending event, NUM_TASKS if there's nothing to do
+// the event is cleared BEFORE the task runs so anything posted while it's running isn't lost
+static uint8_t TakeHighestPriorityEvent(void)
+{
+    uint8_t byTask;
+
+    __disable_irq();
+    for(byTask = 0; byTask < NUM_TASKS; byTask++)
+    {
+        if(pending_events & (1u << byTask))
+        {
+            pending_events &= ~(1u << byTask);
+            break;
+        }
+    }
+    __enable_irq();
+
+    return byTask;
+}
+
+/*============ Exported Functions ============*/
+
+// microsecond timestamp built from the HAL tick and the SysTick down counter (wraps every ~71 minutes, differences are still fine)
+uint32_t Scheduler_GetMicros(void)
+{
+    uint32_t tick;
+    uint32_t count;
+
+    do
+    {
+        tick  = HAL_GetTick();
+        count = SysTick->VAL;
+    } while(tick != HAL_GetTick());  // tick moved on between the two reads, try again
+
+    return (tick * 1000u) + ((SysTick->LOAD - count) / SYSTEMCLOCK_IN_MHZ);
+}
+
+/*-----------------------------------------------------------*/
+
+void Scheduler_AddTask(uint8_t byTask, void (*pTaskFunction)(void))
+{
+    if(byTask < NUM_TASKS)
+    {
+        scheduler_tasks[byTask].pTaskFunction = pTaskFunction;
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+// safe to call from interrupts - marks a task as having work to do, the time of the first post is kept for the latency figures
+void Scheduler_PostEvent(uint8_t byTask)
+{
+    uint32_t primask;
+
+    if(byTask >= NUM_TASKS)
+    {
+        return;
+    }
+
+    primask = __get_PRIMASK();
+    __disable_irq();
+    if((pending_events & (1u << byTask)) == 0)
+    {
+        pending_events |= (1u << byTask);
+        scheduler_tasks[byTask].posted_us = Scheduler_GetMicros();
+    }
+    __set_PRIMASK(primask);
+}
+
+/*-----------------------------------------------------------*/
+
+void Scheduler_ClearStats(uint8_t byTask)
+{
+    if(byTask < NUM_TASKS)
+    {
+        scheduler_tasks[byTask].runs           = 0;
+        scheduler_tasks[byTask].total_run_us   = 0;
+        scheduler_tasks[byTask].max_run_us     = 0;
+        scheduler_tasks[byTask].max_latency_us = 0;
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+/* Run-to-completion scheduler - after every task it goes back to the top, so the highest priority task with an event waiting is always
+ * the next one to run. A task waits at most for whichever single task is already running, rather than for everything else in the loop */
+void Scheduler_Run(void)
+{
+    uint8_t  byTask;
+    int32_t  latency_us;
+    uint32_t start_us;
+    uint32_t run_us;
+    struct task_st *task;
+
+    while(1)
+    {
+        byTask = TakeHighestPriorityEvent();
+
+        if((byTask >= NUM_TASKS) || (scheduler_tasks[byTask].pTaskFunction == NULL))
+        {
+            continue;
+        }
+
+        task = &scheduler_tasks[byTask];
+
+        start_us = Scheduler_GetMicros();
+        latency_us = (int32_t)(start_us - task->posted_us);     // can come out slightly negative if posted from an interrupt just as SysTick wrapped
+        if((latency_us > 0) && ((uint32_t)latency_us > task->max_latency_us))
+        {
+            task->max_latency_us = (uint32_t)latency_us;
+        }
+
+        task->pTaskFunction();
+
+        run_us = Scheduler_GetMicros() - start_us;
+        task->runs++;
+        task->total_run_us += run_us;
+        if(run_us > task->max_run_us)
+        {
+            task->max_run_us = run_us;
+        }
+    }
+}
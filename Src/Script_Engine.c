@@ -0,0 +1,600 @@
+/*******************************************************************************
+* @file           : Script_Engine.c
+* @author         : agent
+* @date           : 18 Oct 2026
+*******************************************************************************/
+
+/*
+******************************************************************************
+* Copyright (c) 2026 TouchNetix
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+******************************************************************************
+*/
+
+/*============ Includes ============*/
+#include "stm32f0xx.h"
+#include "stm32f0xx_hal.h"
+#include <string.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include "_AXPB009_Main.h"
+#include "Script_Engine.h"
+#include "Comms.h"
+#include "Proxy_driver.h"
+#include "Scheduler.h"
+#include "Flash_Control.h"
+#include "Init.h"
+
+/*============ Defines ============*/
+#define READ                            (0x80u)
+#define WRITE                           (0x00u)
+#define SCRIPT_MAGIC                    (0x5C81u)   // start of a script stored in flash (erased flash reads 0xFFFF)
+#define SCRIPT_NUM_OPS                  (SCRIPT_OP_RESET_AXIOM + 1)
+#define SCRIPT_COMMS_ERROR_HOLDOFF_MS   (1000U)     // a comms error straight after a run doesn't start another (aXiom may just be gone)
+
+/*============ Local Structures ============*/
+// laid out as it is stored in flash, the script is saved straight from here
+struct scriptimage_st
+{
+    uint16_t magic;
+    uint16_t length;
+    uint8_t  event_mask;        // SCRIPT_EVENT_xxx that start the script
+    uint8_t  reserved;
+    uint16_t checksum;          // of code[], so a half-written page is never run
+    uint8_t  code[SCRIPT_MAX_BYTES];
+};
+
+struct scriptrun_st
+{
+    uint8_t  state;             // SCRIPT_IDLE etc.
+    uint8_t  error;             // SCRIPT_ERR_xxx, or the code from a FAIL
+    uint8_t  last_event;        // what started the last run (SCRIPT_EVENT_HOST if the host did)
+    uint8_t  pending_events;
+    uint16_t pc;                // offset of the instruction being run
+    bool     boOpStarted;       // DELAY/WAIT at pc has started, op_start_ms is when
+    uint32_t op_start_ms;
+    uint32_t end_ms;
+    bool     boSaved;           // flash holds a valid script
+    uint16_t result_length;
+    uint8_t  results[SCRIPT_MAX_RESULTS];
+};
+
+/*============ Local Variables ============*/
+struct scriptimage_st script_image = {0};
+struct scriptrun_st   script_run = {0};
+
+// no. operand bytes after each opcode (WRITE's data comes on top)
+const uint8_t Script_Operand_Bytes[SCRIPT_NUM_OPS] = {
+    0,  // END
+    3,  // READ        addr(2) len
+    3,  // WRITE       addr(2) len (+ data)
+    2,  // DELAY       ms(2)
+    6,  // WAIT        addr(2) mask value timeout(2)
+    5,  // SKIP_IF_NOT addr(2) mask value n
+    1,  // SKIP        n
+    1,  // MARK        byte
+    1,  // FAIL        code
+    0   // RESET_AXIOM
+};
+
+/*============ Local Function Prototypes ============*/
+static uint16_t Checksum(const uint8_t *pData, uint16_t wdLength);
+static bool     Transfer(uint16_t wdAddress, uint8_t byRW, uint8_t byLength, uint8_t *pWriteData);
+static void     Finish(uint8_t byError);
+
+/*============ Local Functions ============*/
+
+// Fletcher-16 - cheap and still catches swapped bytes
+static uint16_t Checksum(const uint8_t *pData, uint16_t wdLength)
+{
+    uint16_t sum1 = 0;
+    uint16_t sum2 = 0;
+
+    while(wdLength--)
+    {
+        sum1 = (sum1 + *pData++) % 255;
+        sum2 = (sum2 + sum1) % 255;
+    }
+
+    return (uint16_t)((sum2 << 8) | sum1);
+}
+
+/*-----------------------------------------------------------*/
+
+// one aXiom read or write, anything read is left at &aXiom_Rx_Buffer[CircularBufferHead][2]
+static bool Transfer(uint16_t wdAddress, uint8_t byRW, uint8_t byLength, uint8_t *pWriteData)
+{
+    HAL_StatusTypeDef status;
+
+    aXiom_Tx_Buffer[0] = (uint8_t)(wdAddress & 0xFF);
+    aXiom_Tx_Buffer[1] = (uint8_t)(wdAddress >> 8);
+    aXiom_Tx_Buffer[2] = byLength;
+    aXiom_Tx_Buffer[3] = byRW;
+
+    if(byRW == WRITE)
+    {
+        memcpy(&aXiom_Tx_Buffer[4], pWriteData, byLength);
+        aXiom_NumBytesTx = 4 + byLength;
+        aXiom_NumBytesRx = 0;
+    }
+    else
+    {
+        aXiom_NumBytesTx = 4;
+        aXiom_NumBytesRx = byLength;
+    }
+
+    status = Comms_Sequence();
+
+    return (status == HAL_OK);
+}
+
+/*-----------------------------------------------------------*/
+
+static void Finish(uint8_t byError)
+{
+    script_run.state       = (byError == SCRIPT_ERR_NONE) ? SCRIPT_DONE : SCRIPT_FAILED;
+    script_run.error       = byError;
+    script_run.boOpStarted = false;
+    script_run.end_ms      = HAL_GetTick();
+}
+
+/*============ Exported Functions ============*/
+
+// picks up a script stored in flash (if there is one) - called once at startup
+void Script_Init(void)
+{
+#if defined(SCRIPT_FLASH_ADDRESS)
+    const struct scriptimage_st *saved = (const struct scriptimage_st *)SCRIPT_FLASH_ADDRESS;
+
+    if((saved->magic == SCRIPT_MAGIC) && (saved->length <= SCRIPT_MAX_BYTES) && ((saved->event_mask & ~SCRIPT_EVENT_ALL) == 0) &&
+       (saved->checksum == Checksum(saved->code, saved->length)))
+    {
+        memcpy(&script_image, saved, offsetof(struct scriptimage_st, code) + saved->length);
+        script_run.boSaved = true;
+        Script_Event(SCRIPT_EVENT_BOOT);
+    }
+#endif
+}
+
+/*-----------------------------------------------------------*/
+
+// the script is sent a piece at a time in order, an offset of 0 starts a new one
+uint8_t Script_Load(uint16_t wdOffset, uint8_t *pData, uint8_t byLength)
+{
+    if(script_run.state == SCRIPT_RUNNING)
+    {
+        return SCRIPT_BUSY;
+    }
+
+    if(wdOffset == 0)
+    {
+        script_image.length = 0;
+    }
+
+    if((wdOffset != script_image.length) || ((wdOffset + byLength) > SCRIPT_MAX_BYTES))
+    {
+        return SCRIPT_INVALID;
+    }
+
+    memcpy(&script_image.code[wdOffset], pData, byLength);
+    script_image.length += byLength;
+    script_run.state = SCRIPT_IDLE;
+    script_run.error = SCRIPT_ERR_NONE;
+    script_run.pc    = 0;
+
+    return SCRIPT_OK;
+}
+
+/*-----------------------------------------------------------*/
+
+// starts the script from the top, the results of the last run are cleared
+uint8_t Script_Run(uint8_t byEvent)
+{
+    if(script_run.state == SCRIPT_RUNNING)
+    {
+        return SCRIPT_BUSY;
+    }
+
+    if(script_image.length == 0)
+    {
+        return SCRIPT_INVALID;
+    }
+
+    script_run.state         = SCRIPT_RUNNING;
+    script_run.error         = SCRIPT_ERR_NONE;
+    script_run.last_event    = byEvent;
+    script_run.pc            = 0;
+    script_run.boOpStarted   = false;
+    script_run.result_length = 0;
+    Scheduler_PostEvent(TASK_SCRIPT);
+
+    return SCRIPT_OK;
+}
+
+/*-----------------------------------------------------------*/
+
+void Script_Stop(void)
+{
+    script_run.pending_events = 0;
+
+    if(script_run.state == SCRIPT_RUNNING)
+    {
+        Finish(SCRIPT_ERR_STOPPED);
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+uint8_t Script_SetEventMask(uint8_t byMask)
+{
+    if((byMask & ~SCRIPT_EVENT_ALL) != 0)
+    {
+        return SCRIPT_INVALID;
+    }
+
+    script_image.event_mask = byMask;
+    script_run.pending_events &= byMask;
+
+    return SCRIPT_OK;
+}
+
+/*-----------------------------------------------------------*/
+
+// stores the loaded script and event mask so they're picked up again at power on
+uint8_t Script_Save(void)
+{
+#if defined(SCRIPT_FLASH_ADDRESS)
+    if(script_run.state == SCRIPT_RUNNING)
+    {
+        return SCRIPT_BUSY;
+    }
+
+    script_image.magic    = SCRIPT_MAGIC;
+    script_image.checksum = Checksum(script_image.code, script_image.length);
+    script_run.boSaved    = Store_Page_To_Flash(SCRIPT_FLASH_ADDRESS, (uint8_t *)&script_image, offsetof(struct scriptimage_st, code) + script_image.length);
+
+    return (script_run.boSaved) ? SCRIPT_OK : SCRIPT_FLASH_ERROR;
+#else
+    return SCRIPT_FLASH_ERROR;
+#endif
+}
+
+/*-----------------------------------------------------------*/
+
+// the script loaded in RAM is left alone
+uint8_t Script_EraseSaved(void)
+{
+#if defined(SCRIPT_FLASH_ADDRESS)
+    script_run.boSaved = false;
+
+    return (Store_Page_To_Flash(SCRIPT_FLASH_ADDRESS, NULL, 0)) ? SCRIPT_OK : SCRIPT_FLASH_ERROR;
+#else
+    return SCRIPT_FLASH_ERROR;
+#endif
+}
+
+/*-----------------------------------------------------------*/
+
+/* something has happened that the host may want the script run for - only flags it, the script is started from the next tick
+ * (this is called from inside Comms_Sequence() so mustn't do any comms itself) */
+void Script_Event(uint8_t byEvent)
+{
+    if((script_image.event_mask & byEvent) == 0)
+    {
+        return;
+    }
+
+    // the script's own failed transactions are its business, and a dead aXiom shouldn't have the script running back to back
+    if((byEvent == SCRIPT_EVENT_COMMS_ERROR) &&
+       ((script_run.state == SCRIPT_RUNNING) || ((HAL_GetTick() - script_run.end_ms) < SCRIPT_COMMS_ERROR_HOLDOFF_MS)))
+    {
+        return;
+    }
+
+    script_run.pending_events |= byEvent;
+}
+
+/*-----------------------------------------------------------*/
+
+// called every 1ms
+void Script_Tick(void)
+{
+    uint8_t byEvent;
+
+    if(script_run.state == SCRIPT_RUNNING)
+    {
+        Scheduler_PostEvent(TASK_SCRIPT);   // a DELAY or WAIT only looks at the clock when the task runs
+        return;
+    }
+
+    if(script_run.pending_events != 0)
+    {
+        byEvent = script_run.pending_events & (uint8_t)(-script_run.pending_events);    // reported as the lowest one waiting
+        script_run.pending_events = 0;  // one run covers every event that was waiting
+        (void)Script_Run(byEvent);
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+/* runs the instruction at pc, one per call so proxy reads and commands get in between
+ * returns true if the next one can be run straight away, false if the script has finished or is waiting (the tick picks it up again) */
+bool Script_Step(void)
+{
+    uint8_t *pOp;
+    uint8_t  byOpcode;
+    uint8_t  byOperands;
+    uint8_t  byValue;
+    uint16_t wdAddress;
+    uint16_t wdSkip = 0;
+    uint32_t elapsed_ms;
+    uint32_t next_pc;
+
+    if(script_run.state != SCRIPT_RUNNING)
+    {
+        return false;
+    }
+
+    // a multi-page read relies on aXiom_Tx_Buffer staying put between reads
+    if(ProxyMP_TotalNumBytesRx != 0)
+    {
+        return true;
+    }
+
+    if(script_run.pc >= script_image.length)
+    {
+        Finish(SCRIPT_ERR_NONE);
+        return false;
+    }
+
+    pOp      = &script_image.code[script_run.pc];
+    byOpcode = pOp[0];
+
+    if(byOpcode >= SCRIPT_NUM_OPS)
+    {
+        Finish(SCRIPT_ERR_BAD_SCRIPT);
+        return false;
+    }
+
+    byOperands = Script_Operand_Bytes[byOpcode];
+    if((script_run.pc + 1 + byOperands) > script_image.length)
+    {
+        Finish(SCRIPT_ERR_BAD_SCRIPT);
+        return false;
+    }
+
+    wdAddress = ((uint16_t)pOp[2] << 8) | pOp[1];  // not an address for every opcode, but harmless
+
+    switch(byOpcode)
+    {
+        case SCRIPT_OP_END:
+        {
+            Finish(SCRIPT_ERR_NONE);
+            return false;
+        }
+        case SCRIPT_OP_READ:
+        {
+            if((pOp[3] == 0) || (pOp[3] > SCRIPT_MAX_XFER))
+            {
+                Finish(SCRIPT_ERR_BAD_SCRIPT);
+                return false;
+            }
+            if((script_run.result_length + pOp[3]) > SCRIPT_MAX_RESULTS)
+            {
+                Finish(SCRIPT_ERR_RESULTS_FULL);
+                return false;
+            }
+            if(Transfer(wdAddress, READ, pOp[3], NULL) == false)
+            {
+                Finish(SCRIPT_ERR_COMMS);
+                return false;
+            }
+            memcpy(&script_run.results[script_run.result_length], &aXiom_Rx_Buffer[CircularBufferHead][2], pOp[3]);
+            script_run.result_length += pOp[3];
+            break;
+        }
+        case SCRIPT_OP_WRITE:
+        {
+            byOperands += pOp[3];
+            if((pOp[3] == 0) || (pOp[3] > SCRIPT_MAX_XFER) || ((script_run.pc + 1 + byOperands) > script_image.length))
+            {
+                Finish(SCRIPT_ERR_BAD_SCRIPT);
+                return false;
+            }
+            if(Transfer(wdAddress, WRITE, pOp[3], &pOp[4]) == false)
+            {
+                Finish(SCRIPT_ERR_COMMS);
+                return false;
+            }
+            break;
+        }
+        case SCRIPT_OP_DELAY:
+        {
+            if(script_run.boOpStarted == false)
+            {
+                script_run.boOpStarted = true;
+                script_run.op_start_ms = HAL_GetTick();
+            }
+            if((HAL_GetTick() - script_run.op_start_ms) < wdAddress)    // operand is the delay in ms
+            {
+                return false;
+            }
+            break;
+        }
+        case SCRIPT_OP_WAIT:
+        {
+            if(script_run.boOpStarted == false)
+            {
+                script_run.boOpStarted = true;
+                script_run.op_start_ms = HAL_GetTick();
+            }
+            elapsed_ms = HAL_GetTick() - script_run.op_start_ms;
+
+            // a comms error just counts as not there yet - aXiom may well NAK while it's busy (e.g. booting)
+            if((Transfer(wdAddress, READ, 1, NULL) == false) || ((aXiom_Rx_Buffer[CircularBufferHead][2] & pOp[3]) != pOp[4]))
+            {
+                if(elapsed_ms >= (((uint16_t)pOp[6] << 8) | pOp[5]))
+                {
+                    Finish(SCRIPT_ERR_TIMEOUT);
+                }
+                return false;
+            }
+            break;
+        }
+        case SCRIPT_OP_SKIP_IF_NOT:
+        {
+            if(Transfer(wdAddress, READ, 1, NULL) == false)
+            {
+                Finish(SCRIPT_ERR_COMMS);
+                return false;
+            }
+            byValue = aXiom_Rx_Buffer[CircularBufferHead][2];
+            if((byValue & pOp[3]) != pOp[4])
+            {
+                wdSkip = pOp[5];
+            }
+            break;
+        }
+        case SCRIPT_OP_SKIP:
+        {
+            wdSkip = pOp[1];
+            break;
+        }
+        case SCRIPT_OP_MARK:
+        {
+            if(script_run.result_length >= SCRIPT_MAX_RESULTS)
+            {
+                Finish(SCRIPT_ERR_RESULTS_FULL);
+                return false;
+            }
+            script_run.results[script_run.result_length++] = pOp[1];
+            break;
+        }
+        case SCRIPT_OP_FAIL:
+        {
+            Finish(pOp[1]);
+            return false;
+        }
+        case SCRIPT_OP_RESET_AXIOM:
+        {
+            HAL_GPIO_WritePin(nRESET_GPIO_Port, nRESET, RESET);
+            HAL_Delay(1);
+            HAL_GPIO_WritePin(nRESET_GPIO_Port, nRESET, SET);
+            break;
+        }
+        default:
+        {
+            break;
+        }
+    }
+
+    next_pc = (uint32_t)script_run.pc + 1 + byOperands + wdSkip;
+    if(next_pc > script_image.length)
+    {
+        Finish(SCRIPT_ERR_BAD_SCRIPT);
+        return false;
+    }
+
+    script_run.pc          = (uint16_t)next_pc;
+    script_run.boOpStarted = false;
+
+    return true;
+}
+
+/*-----------------------------------------------------------*/
+
+uint8_t Script_GetState(void)
+{
+    return script_run.state;
+}
+
+/*-----------------------------------------------------------*/
+
+uint16_t Script_GetPC(void)
+{
+    return script_run.pc;
+}
+
+/*-----------------------------------------------------------*/
+
+uint8_t Script_GetError(void)
+{
+    return script_run.error;
+}
+
+/*-----------------------------------------------------------*/
+
+uint8_t Script_GetEventMask(void)
+{
+    return script_image.event_mask;
+}
+
+/*-----------------------------------------------------------*/
+
+uint8_t Script_GetLastEvent(void)
+{
+    return script_run.last_event;
+}
+
+/*-----------------------------------------------------------*/
+
+uint16_t Script_GetLength(void)
+{
+    return script_image.length;
+}
+
+/*-----------------------------------------------------------*/
+
+bool Script_IsSaved(void)
+{
+    return script_run.boSaved;
+}
+
+/*-----------------------------------------------------------*/
+
+uint16_t Script_GetResultLength(void)
+{
+    return script_run.result_length;
+}
+
+/*-----------------------------------------------------------*/
+
+// copies up to byMax result bytes from wdOffset, returns how many were copied (can be read while the script is still running)
+uint8_t Script_ReadResults(uint16_t wdOffset, uint8_t *pDest, uint8_t byMax)
+{
+    uint16_t wdCount;
+
+    if(wdOffset >= script_run.result_length)
+    {
+        return 0;
+    }
+
+    wdCount = script_run.result_length - wdOffset;
+    if(wdCount > byMax)
+    {
+        wdCount = byMax;
+    }
+
+    memcpy(pDest, &script_run.results[wdOffset], wdCount);
+
+    return (uint8_t)wdCount;
+}
+
+/*-----------------------------------------------------------*/
@@ -38,32 +38,38 @@
 #include "usbd_mouse.h"
 #include "usbd_mouse_if.h"
 #include "Digitizer.h"
+#include "Timers_and_LEDs.h"
 
 /*============ Defines ============*/
-#define LED_FREQ_DIV  (0x5)
+#define LED_FLASH_MS            (20)    // how long an LED stays lit after a comms event
+#define INACTIVITY_TIMEOUT_MS   (100)   // no comms for this long and the heartbeat starts
+#define HEARTBEAT_PERIOD_MS     (1500)  // LED stays lit for this long...
+#define HEARTBEAT_OFF_MS        (50)    // ...then blinks off for this long
 
 /*============ Local Variables ============*/
 
 /*============ Exported Variables ============*/
-uint32_t aXiom_activity_counter = 0;
-uint32_t USB_activity_counter = 0;
-bool     boAxiomActivity = 0;
-bool     boUSBActivity = 0;
-bool     boFlashAxiomLED = 0;
-bool     boFlashUSBLED = 0;
+volatile uint32_t aXiom_activity_counter = 0;  // ms since the last aXiom comms (stops counting at INACTIVITY_TIMEOUT_MS)
+volatile uint32_t USB_activity_counter = 0;    // ms since the last USB report
+volatile bool     boAxiomActivity = 0;
+volatile bool     boUSBActivity = 0;
+volatile bool     boFlashAxiomLED = 0;
+volatile bool     boFlashUSBLED = 0;
 
+/*============ Local Function Prototypes ============*/
+static void LED_control(void);
+static void comms_detect_inactivity(void);
 
 /*============ Local Functions ============*/
 
-/*============ Exported Functions ============*/
-
-void LED_control(void)
+// turns off the LEDs once a recent comms event has had them on for LED_FLASH_MS
+static void LED_control(void)
 {
     if(boFlashAxiomLED == 1)
     {
         static uint32_t AxiomLEDCounter = 0;
 
-        if(AxiomLEDCounter >= 5)
+        if(AxiomLEDCounter >= LED_FLASH_MS)
         {
             HAL_GPIO_WritePin(LED_AXIOM_GPIO_Port, LED_AXIOM_Pin, RESET);
             AxiomLEDCounter = 0;
@@ -72,7 +78,7 @@ void LED_control(void)
         else
         {
             HAL_GPIO_WritePin(LED_AXIOM_GPIO_Port, LED_AXIOM_Pin, GPIO_PIN_SET);
-            AxiomLEDCounter++;
+            AxiomLEDCounter += LED_TICK_MS;
         }
     }
 
@@ -80,7 +86,7 @@ void LED_control(void)
     {
         static uint32_t AxiomUSBCounter = 0;
 
-        if(AxiomUSBCounter >= 5)
+        if(AxiomUSBCounter >= LED_FLASH_MS)
         {
             HAL_GPIO_WritePin(LED_USB_GPIO_Port, LED_USB_Pin, RESET);
             AxiomUSBCounter = 0;
@@ -89,14 +95,15 @@ void LED_control(void)
         else
         {
             HAL_GPIO_WritePin(LED_USB_GPIO_Port, LED_USB_Pin, GPIO_PIN_SET);
-            AxiomUSBCounter++;
+            AxiomUSBCounter += LED_TICK_MS;
         }
     }
 }
 
 //--------------------------
 
-void comms_detect_inactivity(void)
+// once a link has been quiet for INACTIVITY_TIMEOUT_MS its LED is held on, blinking off briefly every heartbeat
+static void comms_detect_inactivity(void)
 {
     uint32_t static heartbeat_axiom = 0;
     uint32_t static heartbeat_usb = 0;
@@ -104,24 +111,19 @@ void comms_detect_inactivity(void)
     // check if there is any SPI activity
     if(boAxiomActivity == 0)
     {
-        if(aXiom_activity_counter >= 10000)
+        if(aXiom_activity_counter >= INACTIVITY_TIMEOUT_MS)
         {
-            // Once no activity has been detected, start a heartbeat pulse
-            if(heartbeat_axiom >= 150000)
+            if(heartbeat_axiom >= (HEARTBEAT_PERIOD_MS + HEARTBEAT_OFF_MS))
             {
-                HAL_GPIO_WritePin(LED_AXIOM_GPIO_Port, LED_AXIOM_Pin, RESET);
-                HAL_Delay(50);
                 heartbeat_axiom = 0;
             }
-            else
-            {
-                HAL_GPIO_WritePin(LED_AXIOM_GPIO_Port, LED_AXIOM_Pin, SET);
-                heartbeat_axiom++;
-            }
+
+            HAL_GPIO_WritePin(LED_AXIOM_GPIO_Port, LED_AXIOM_Pin, (heartbeat_axiom < HEARTBEAT_PERIOD_MS) ? GPIO_PIN_SET : GPIO_PIN_RESET);
+            heartbeat_axiom += LED_TICK_MS;
         }
         else
         {
-            aXiom_activity_counter++;
+            aXiom_activity_counter += LED_TICK_MS;
         }
     }
     else
@@ -134,24 +136,19 @@ void comms_detect_inactivity(void)
     // check if there is any USB activity
     if(boUSBActivity == 0)
     {
-        if(USB_activity_counter >= 10000)
+        if(USB_activity_counter >= INACTIVITY_TIMEOUT_MS)
         {
-            // Once no activity has been detected, start a heartbeat pulse
-            if(heartbeat_usb >= 150000)
+            if(heartbeat_usb >= (HEARTBEAT_PERIOD_MS + HEARTBEAT_OFF_MS))
             {
-                HAL_GPIO_WritePin(LED_USB_GPIO_Port, LED_USB_Pin, RESET);
-                HAL_Delay(50);
                 heartbeat_usb = 0;
             }
-            else
-            {
-                HAL_GPIO_WritePin(LED_USB_GPIO_Port, LED_USB_Pin, SET);
-                heartbeat_usb++;
-            }
+
+            HAL_GPIO_WritePin(LED_USB_GPIO_Port, LED_USB_Pin, (heartbeat_usb < HEARTBEAT_PERIOD_MS) ? GPIO_PIN_SET : GPIO_PIN_RESET);
+            heartbeat_usb += LED_TICK_MS;
         }
         else
         {
-            USB_activity_counter++;
+            USB_activity_counter += LED_TICK_MS;
         }
     }
     else
@@ -162,13 +159,14 @@ void comms_detect_inactivity(void)
     }
 }
 
-//--------------------------
+/*============ Exported Functions ============*/
 
-// callback function when TIM16 has reset --> used to increment the digitizer timestamp
+// TIM17 update --> entered every LED_TICK_MS, all LED timing is done from here so nothing in the main loop has to wait on an LED
 void HAL_TIM_PeriodElapsedCallback(TIM_HandleTypeDef *htim)
 {
-    if(htim == &htim16)
+    if(htim == &htim17)
     {
-        wd100usTick++; // increment the digitizer timestamp --> this callback is entered every 100us, which is what windows is expecting
+        LED_control();
+        comms_detect_inactivity();
     }
 }
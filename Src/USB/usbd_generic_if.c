@@ -31,6 +31,7 @@
 #include "usbd_press_if.h"
 #include "Mode_Control.h"
 #include "stm32f0xx_hal.h"
+#include "Command_Processor.h"
 
 /*============ Defines ============*/
 
@@ -46,7 +47,6 @@
 
 /*============ Exported Variables ============*/
 volatile bool   boCommandWaitingToDecode = false;
-bool    boGenericReportToSend = 0;
 uint8_t *pTBPCommandReportGeneric = 0;
 
  /* USB Generic HID Report Descriptor */
@@ -91,6 +91,8 @@ __ALIGN_BEGIN static uint8_t GENERIC_HID_ReportDesc_FS[USBD_GENERIC_HID_REPORT_D
 static int8_t GENERIC_HID_Init_FS(void);
 static int8_t GENERIC_HID_DeInit_FS(void);
 static int8_t GENERIC_HID_OutEvent_FS(uint8_t* state);
+static uint8_t* GENERIC_HID_ControlOutReserve_FS(void);
+static int8_t GENERIC_HID_ControlOutEvent_FS(void);
 
 /*============ TypeDefs ============*/
 USBD_GENERIC_HID_ItfTypeDef USBD_GenericHID_fops_FS =
@@ -98,7 +100,9 @@ USBD_GENERIC_HID_ItfTypeDef USBD_GenericHID_fops_FS =
   GENERIC_HID_ReportDesc_FS,
   GENERIC_HID_Init_FS,
   GENERIC_HID_DeInit_FS,
-  GENERIC_HID_OutEvent_FS
+  GENERIC_HID_OutEvent_FS,
+  GENERIC_HID_ControlOutReserve_FS,
+  GENERIC_HID_ControlOutEvent_FS
 };
 
 /*============ Function ============*/
@@ -136,17 +140,30 @@ static int8_t GENERIC_HID_OutEvent_FS(uint8_t* state)
     /* USER CODE BEGIN 6 */
     GPIOC->ODR ^= GPIO_ODR_9;
 
-    // set pointer to out buffer
-    pTBPCommandReportGeneric = state;
+    // copy the command into the FIFO (flags it to be processed) - endpoint isn't re-armed if that filled the FIFO
+    return CommandFIFO_Receive(GENERIC_INTERFACE_NUM, state);
+    /* USER CODE END 6 */
+}
 
-    // temporarily stop all reports
-    boBlockReports = 1;
+/**
+  * @brief  SET_REPORT on the control endpoint, setup stage
+  * @retval buffer for the data stage, NULL if the command FIFO is full (request is stalled)
+  */
+static uint8_t* GENERIC_HID_ControlOutReserve_FS(void)
+{
+    return CommandFIFO_ReserveControl();
+}
 
-    // set flag to tell to process instruction and say which interface it came from
-    boCommandWaitingToDecode = 1;
-    target_interface = GENERIC_INTERFACE_NUM;
-    return (USBD_OK);
-    /* USER CODE END 6 */
+/**
+  * @brief  SET_REPORT on the control endpoint, data stage
+  * @retval USBD_OK if all operations are OK else USBD_FAIL
+  */
+static int8_t GENERIC_HID_ControlOutEvent_FS(void)
+{
+    GPIOC->ODR ^= GPIO_ODR_9;
+
+    // queued into the entry held back at the setup stage
+    return CommandFIFO_ReceiveControl(GENERIC_INTERFACE_NUM);
 }
 /************************ (C) COPYRIGHT STMicroelectronics *****END OF FILE****/
 
@@ -46,7 +46,6 @@ static int8_t MOUSE_HID_DeInit_FS(void);
 static int8_t MOUSE_HID_OutEvent_FS(uint8_t* state);
 
 /*============ Exported Variables ============*/
-bool    boMouseReportToSend = 0;
 uint8_t BridgeMode          = MODE_TBP_BASIC;
 uint8_t byMouseReportLength = 0;
 uint8_t usb_hid_mouse_report_in[USBD_MOUSE_HID_REPORT_IN_SIZE] = {0}; // buffer used to send report to host
@@ -29,6 +29,7 @@
 #include "usbd_press_if.h"
 #include <stdbool.h>
 #include "Mode_Control.h"
+#include "Command_Processor.h"
 
 /*============ Defines ============*/
 
@@ -40,7 +41,6 @@
 
 
 /*============ Exported Variables ============*/
-bool boPressReportToSend = 0;
 uint8_t usb_hid_press_report_in[USBD_PRESS_HID_REPORT_IN_SIZE] = {0}; // buffer used to send report to host
 uint8_t *pTBPCommandReportPress = 0;
 
@@ -49,6 +49,8 @@ uint8_t *pTBPCommandReportPress = 0;
 static int8_t PRESS_HID_Init_FS(void);
 static int8_t PRESS_HID_DeInit_FS(void);
 static int8_t PRESS_HID_OutEvent_FS(uint8_t* state);
+static uint8_t* PRESS_HID_ControlOutReserve_FS(void);
+static int8_t PRESS_HID_ControlOutEvent_FS(void);
 
 
  /* USB Press HID Report Descriptor */
@@ -100,7 +102,9 @@ USBD_PRESS_HID_ItfTypeDef USBD_PressHID_fops_FS =
   PRESS_HID_ReportDesc_FS,
   PRESS_HID_Init_FS,
   PRESS_HID_DeInit_FS,
-  PRESS_HID_OutEvent_FS
+  PRESS_HID_OutEvent_FS,
+  PRESS_HID_ControlOutReserve_FS,
+  PRESS_HID_ControlOutEvent_FS
 };
 
 /*============ Functions ============*/
@@ -134,15 +138,31 @@ static int8_t PRESS_HID_DeInit_FS(void)
   */
 static int8_t PRESS_HID_OutEvent_FS(uint8_t* state)
 {
-    // set flag to tell to process instruction and say which interface it came from
-    boCommandWaitingToDecode = 1;
-    target_interface = PRESS_INTERFACE_NUM;
+    GPIOC->ODR ^= GPIO_ODR_9;
+
+    // copy the command into the FIFO (flags it to be processed) - endpoint isn't re-armed if that filled the FIFO
+    return CommandFIFO_Receive(PRESS_INTERFACE_NUM, state);
+}
+
+/**
+  * @brief  SET_REPORT on the control endpoint, setup stage
+  * @retval buffer for the data stage, NULL if the command FIFO is full (request is stalled)
+  */
+static uint8_t* PRESS_HID_ControlOutReserve_FS(void)
+{
+    return CommandFIFO_ReserveControl();
+}
 
+/**
+  * @brief  SET_REPORT on the control endpoint, data stage
+  * @retval USBD_OK if all operations are OK else USBD_FAIL
+  */
+static int8_t PRESS_HID_ControlOutEvent_FS(void)
+{
     GPIOC->ODR ^= GPIO_ODR_9;
 
-    // set pointer to out buffer
-    pTBPCommandReportPress = state;
-    return (USBD_OK);
+    // queued into the entry held back at the setup stage
+    return CommandFIFO_ReceiveControl(PRESS_INTERFACE_NUM);
 }
 
 /************************ (C) COPYRIGHT STMicroelectronics *****END OF FILE****/
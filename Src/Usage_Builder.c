@@ -126,6 +126,41 @@ int8_t find_usage_from_table(uint8_t byUsagenum)
 
 //--------------------------
 
+/* no. entries in the usage table (some are report placeholders with no pages)
+ * @return no. usages - 0 if the table couldn't be read off aXiom
+ */
+uint8_t get_num_usages(void)
+{
+    if(boUsageTablePopulated == 0)
+    {
+        build_usage_table();
+    }
+
+    return numusages;
+}
+
+//--------------------------
+
+// how many bytes long the usage is
+uint16_t UsageLengthInBytes(int16_t usage_table_idx)
+{
+    return ((usagetable[usage_table_idx].maxoffset & 0x80) == 0x00) ?
+           ((uint16_t)usagetable[usage_table_idx].numpages) * (((uint16_t)(usagetable[usage_table_idx].maxoffset & 0x7F) + 1) * 2) :
+           (((uint16_t)usagetable[usage_table_idx].numpages - 1) << 7) + (((uint16_t)(usagetable[usage_table_idx].maxoffset & 0x7F) + 1) * 2);
+}
+
+//--------------------------
+
+// aXiom address of a byte in a usage, given the page (relative to the usage's first page) and byte offset into that page
+uint16_t UsageAddress(int16_t usage_table_idx, uint8_t byPage, uint8_t byOffset)
+{
+    return ((usagetable[usage_table_idx].maxoffset & 0x80) == 0x00) ?
+           ((uint16_t)usagetable[usage_table_idx].startpage << 8) + (((uint16_t)byPage * ((uint16_t)(usagetable[usage_table_idx].maxoffset & 0x7F) + 1)) * 2) + byOffset :
+           ((uint16_t)usagetable[usage_table_idx].startpage << 8) + (((uint16_t)byPage * 2) + byOffset);
+}
+
+//--------------------------
+
 /* builds the usage table from aXiom at startup
  * @return Status
  */
@@ -0,0 +1,357 @@
+/*******************************************************************************
+* @file           : Usage_Snapshot.c
+* @author         : agent
+* @date           : 18 Oct 2026
+*******************************************************************************/
+
+/*
+******************************************************************************
+* Copyright (c) 2026 TouchNetix
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+******************************************************************************
+*/
+
+/*============ Includes ============*/
+#include "stm32f0xx.h"
+#include "stm32f0xx_hal.h"
+#include <string.h>
+#include <stdbool.h>
+#include "Usage_Snapshot.h"
+#include "Usage_Builder.h"
+#include "Block_Write.h"
+#include "Comms.h"
+#include "Proxy_driver.h"
+#include "Scheduler.h"
+#include "Init.h"
+
+/*============ Defines ============*/
+#define READ                    (0x80u)
+#define AXIOM_PAGE_SIZE         (256U)  // a single read can't run past the end of an aXiom page
+#define u02                     (0x02u) // system manager - writing it back would run whatever command was last in it
+#define u31                     (0x31u) // device info, read only
+#define u32                     (0x32u) // device capabilities, read only
+#define u33                     (0x33u) // CRC data, read only
+
+/*============ Local Structures ============*/
+struct usagesnapshot_st
+{
+    bool     boActive;
+    uint8_t  table_idx;         // usage being sent
+    uint16_t offset;            // next byte of that usage to send
+    uint8_t  sequence;          // sequence no. of the next packet
+    uint8_t  usages_sent;
+    uint32_t total_bytes;
+};
+
+struct usagerestore_st
+{
+    bool     boOpen;
+    uint8_t  sequence;          // sequence no. expected on the next packet
+    uint8_t  unacked;           // packets since the last acknowledgement
+    uint8_t  usage;             // usage no. of the last packet written
+    uint32_t written;
+    uint32_t skipped;           // data bytes of usages that aren't written back
+};
+
+/*============ Local Variables ============*/
+struct usagesnapshot_st usage_snapshot = {0};
+struct usagerestore_st  usage_restore = {0};
+
+/*============ Local Function Prototypes ============*/
+static void ReadChunk(uint16_t wdAddress, uint8_t byLength);
+static bool RestoreSkipsUsage(uint8_t byUsage);
+
+/*============ Local Functions ============*/
+
+// usages a snapshot includes (so the host has a full record) but a restore doesn't write - they're read only or a command
+static bool RestoreSkipsUsage(uint8_t byUsage)
+{
+    return ((byUsage == u02) || (byUsage == u31) || (byUsage == u32) || (byUsage == u33));
+}
+
+/*-----------------------------------------------------------*/
+
+static void ReadChunk(uint16_t wdAddress, uint8_t byLength)
+{
+    aXiom_Tx_Buffer[0] = (uint8_t)(wdAddress & 0xFF);
+    aXiom_Tx_Buffer[1] = (uint8_t)(wdAddress >> 8);
+    aXiom_Tx_Buffer[2] = byLength;
+    aXiom_Tx_Buffer[3] = READ;
+    aXiom_NumBytesTx = 4;
+    aXiom_NumBytesRx = byLength;
+
+    (void)Comms_Sequence();
+}
+
+/*============ Exported Functions ============*/
+
+// starts sending every usage up the generic endpoint, returns false if there's no usage table (aXiom not there)
+bool UsageSnapshot_Start(void)
+{
+    memset(&usage_snapshot, 0, sizeof(usage_snapshot));
+
+    if(get_num_usages() == 0)
+    {
+        return false;
+    }
+
+    usage_snapshot.boActive = true;
+    Scheduler_PostEvent(TASK_USAGE_SNAPSHOT);
+
+    return true;
+}
+
+/*-----------------------------------------------------------*/
+
+void UsageSnapshot_Stop(void)
+{
+    usage_snapshot.boActive = false;
+}
+
+/*-----------------------------------------------------------*/
+
+// no. usages a snapshot sends, and how many data bytes that comes to
+uint8_t UsageSnapshot_CountUsages(uint32_t *pTotalBytes)
+{
+    uint8_t byNumUsages = get_num_usages();
+    uint8_t byCount = 0;
+
+    *pTotalBytes = 0;
+    for(uint8_t i = 0; i < byNumUsages; i++)
+    {
+        if(usagetable[i].numpages != 0)
+        {
+            *pTotalBytes += UsageLengthInBytes(i);
+            byCount++;
+        }
+    }
+
+    return byCount;
+}
+
+/*-----------------------------------------------------------*/
+
+/* reads the next piece of the snapshot straight into the ring, one packet per call so nothing else is held up for long
+ * returns true if there's more to go straight away - false (snapshot still running) while waiting for room in the ring */
+bool UsageSnapshot_ReadNext(void)
+{
+    uint8_t *pSlot;
+    uint16_t wdLength;
+    uint16_t wdAddress;
+    uint16_t wdChunk;
+    uint8_t  byStatus;
+
+    if(usage_snapshot.boActive == false)
+    {
+        return false;
+    }
+
+    // a multi-page read relies on aXiom_Tx_Buffer staying put between reads, and the ring has to have room for this packet
+    if((ProxyMP_TotalNumBytesRx != 0) || CircularBuffer_IsFull())
+    {
+        return false;   // USBInTask posts this again once a slot is freed, BlockReadTask once the multi-page read is done
+    }
+
+    // report placeholders have no pages, so nothing to save
+    while((usage_snapshot.table_idx < get_num_usages()) && (usagetable[usage_snapshot.table_idx].numpages == 0))
+    {
+        usage_snapshot.table_idx++;
+    }
+
+    pSlot = aXiom_Rx_Buffer[CircularBufferHead];
+
+    if(usage_snapshot.table_idx >= get_num_usages())
+    {
+        memset(pSlot, 0, USBD_GENERIC_HID_REPORT_IN_SIZE);
+        pSlot[0]  = USAGE_SNAPSHOT_FLAG;
+        pSlot[1]  = SNAPSHOT_END;
+        pSlot[2]  = usage_snapshot.sequence;
+        pSlot[3]  = usage_snapshot.usages_sent;
+        memcpy(&pSlot[SNAPSHOT_HEADER_BYTES], &usage_snapshot.total_bytes, sizeof(usage_snapshot.total_bytes));   // little endian, lo first
+        (void)CircularBuffer_Push();   // can't be full, checked above
+        Scheduler_PostEvent(TASK_USB_IN);
+
+        usage_snapshot.boActive = false;
+        return false;
+    }
+
+    wdLength  = UsageLengthInBytes(usage_snapshot.table_idx);
+    wdAddress = UsageAddress(usage_snapshot.table_idx, 0, 0) + usage_snapshot.offset;
+    wdChunk   = wdLength - usage_snapshot.offset;
+    if(wdChunk > SNAPSHOT_MAX_DATA)
+    {
+        wdChunk = SNAPSHOT_MAX_DATA;
+    }
+    if(wdChunk > (AXIOM_PAGE_SIZE - (wdAddress & (AXIOM_PAGE_SIZE - 1))))
+    {
+        wdChunk = AXIOM_PAGE_SIZE - (wdAddress & (AXIOM_PAGE_SIZE - 1));
+    }
+
+    ReadChunk(wdAddress, (uint8_t)wdChunk);
+
+    byStatus = pSlot[0];
+    if((byStatus != COMMS_OK) && (byStatus != COMMS_OK_NO_READ))
+    {
+        // a snapshot with a hole in it is no use for a restore, so stop here - the host sees where it got to
+        wdChunk = 0;
+        usage_snapshot.boActive = false;
+    }
+
+    memmove(&pSlot[SNAPSHOT_HEADER_BYTES], &pSlot[2], wdChunk);
+    memset(&pSlot[SNAPSHOT_HEADER_BYTES + wdChunk], 0, USBD_GENERIC_HID_REPORT_IN_SIZE - SNAPSHOT_HEADER_BYTES - wdChunk);
+    pSlot[0] = USAGE_SNAPSHOT_FLAG;
+    pSlot[1] = (usage_snapshot.boActive) ? SNAPSHOT_DATA : SNAPSHOT_COMMS_ERROR;
+    pSlot[2] = usage_snapshot.sequence++;
+    pSlot[3] = usagetable[usage_snapshot.table_idx].usagenum;
+    pSlot[4] = usagetable[usage_snapshot.table_idx].uifrevision;
+    pSlot[5] = (uint8_t)(usage_snapshot.offset & 0xFF);
+    pSlot[6] = (uint8_t)(usage_snapshot.offset >> 8);
+    pSlot[7] = (uint8_t)wdChunk;
+    (void)CircularBuffer_Push();   // can't be full, checked above
+    Scheduler_PostEvent(TASK_USB_IN);
+
+    usage_snapshot.offset      += wdChunk;
+    usage_snapshot.total_bytes += wdChunk;
+    if(usage_snapshot.offset >= wdLength)
+    {
+        usage_snapshot.table_idx++;
+        usage_snapshot.offset = 0;
+        usage_snapshot.usages_sent++;
+    }
+
+    return usage_snapshot.boActive;
+}
+
+/*-----------------------------------------------------------*/
+
+// the next restore packet has to be sequence no. 0
+void UsageRestore_Open(void)
+{
+    UsageRestore_Close();
+    (void)get_num_usages();     // makes sure the usage table has been read before the first packet arrives
+    usage_restore.boOpen = true;
+}
+
+/*-----------------------------------------------------------*/
+
+void UsageRestore_Close(void)
+{
+    memset(&usage_restore, 0, sizeof(usage_restore));
+}
+
+/*-----------------------------------------------------------*/
+
+/* writes one snapshot packet back to aXiom, no response is needed unless this packet completes a window, is the end packet or fails
+ * each usage is checked against this aXiom's usage table first, so a snapshot from a different aXiom (or firmware) isn't written
+ * read only usages (u31-u33) and the system manager command usage (u02) are checked the same way but not written back
+ * returns true if pReport has been overwritten with an acknowledgement that should be sent to the host
+ * acknowledgement - 1: status, 2: sequence no. of the last packet written, 3: its usage no., 4-7: data bytes written (lo first) */
+bool UsageRestore_Data(uint8_t *pReport, uint8_t byPayloadEnd)
+{
+    uint8_t  bySequence = pReport[2];
+    uint8_t  byLength   = pReport[7];
+    uint16_t wdOffset   = ((uint16_t)pReport[6] << 8) | pReport[5];
+    uint32_t total_bytes;
+    int16_t  usage_table_idx;
+    uint8_t  byStatus   = USAGE_RESTORE_OK;
+    bool     boAck      = false;
+    bool     boFinished = false;
+
+    if(usage_restore.boOpen == false)
+    {
+        byStatus = USAGE_RESTORE_NOT_OPEN;
+    }
+    else if(bySequence != usage_restore.sequence)
+    {
+        byStatus = USAGE_RESTORE_SEQUENCE_ERROR;
+    }
+    else if(pReport[1] == SNAPSHOT_END)
+    {
+        // nothing to write, but a short total means the host left something out
+        memcpy(&total_bytes, &pReport[SNAPSHOT_HEADER_BYTES], sizeof(total_bytes));
+        byStatus   = (total_bytes == (usage_restore.written + usage_restore.skipped)) ? USAGE_RESTORE_OK : USAGE_RESTORE_INVALID;
+        boFinished = true;
+        usage_restore.sequence++;
+    }
+    else if((pReport[1] != SNAPSHOT_DATA) || (byLength == 0) || (byLength > (byPayloadEnd - SNAPSHOT_HEADER_BYTES)))
+    {
+        byStatus = USAGE_RESTORE_INVALID;
+    }
+    else
+    {
+        usage_table_idx = find_usage_from_table(pReport[3]);
+
+        if((usage_table_idx < 0) || (usagetable[usage_table_idx].numpages == 0) || (usagetable[usage_table_idx].uifrevision != pReport[4]))
+        {
+            byStatus = USAGE_RESTORE_MISMATCH;
+        }
+        else if(((uint32_t)wdOffset + byLength) > UsageLengthInBytes(usage_table_idx))
+        {
+            byStatus = USAGE_RESTORE_MISMATCH;
+        }
+        else if(RestoreSkipsUsage(pReport[3]))
+        {
+            usage_restore.skipped += byLength;
+            usage_restore.sequence++;
+            usage_restore.unacked++;
+        }
+        else if(BlockWrite_ToAxiom(UsageAddress(usage_table_idx, 0, 0) + wdOffset, &pReport[SNAPSHOT_HEADER_BYTES], byLength) == false)
+        {
+            byStatus = USAGE_RESTORE_COMMS_ERROR;
+        }
+        else
+        {
+            usage_restore.usage    = pReport[3];
+            usage_restore.written += byLength;
+            usage_restore.sequence++;
+            usage_restore.unacked++;
+        }
+    }
+
+    if((byStatus == USAGE_RESTORE_OK) && ((usage_restore.unacked >= USAGE_RESTORE_WINDOW) || boFinished))
+    {
+        usage_restore.unacked = 0;
+        boAck = true;
+    }
+
+    if(byStatus != USAGE_RESTORE_OK)
+    {
+        // restore is closed below - the host has to open it again and start from the first packet
+        boAck = true;
+    }
+
+    if(boAck)
+    {
+        pReport[1] = byStatus;
+        pReport[2] = (uint8_t)(usage_restore.sequence - 1);
+        pReport[3] = usage_restore.usage;
+        memcpy(&pReport[4], &usage_restore.written, sizeof(usage_restore.written));
+        memset(&pReport[8], 0, byPayloadEnd - 8);
+    }
+
+    if((byStatus != USAGE_RESTORE_OK) || boFinished)
+    {
+        UsageRestore_Close();
+    }
+
+    return boAck;
+}
+
+/*-----------------------------------------------------------*/
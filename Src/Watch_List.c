@@ -0,0 +1,281 @@
+/*******************************************************************************
+* @file           : Watch_List.c
+* @author         : agent
+* @date           : 18 Oct 2026
+*******************************************************************************/
+
+/*
+******************************************************************************
+* Copyright (c) 2026 TouchNetix
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+******************************************************************************
+*/
+
+/*============ Includes ============*/
+#include "stm32f0xx.h"
+#include "stm32f0xx_hal.h"
+#include <string.h>
+#include <stdbool.h>
+#include "Watch_List.h"
+#include "Comms.h"
+#include "Proxy_driver.h"
+#include "Scheduler.h"
+#include "Init.h"
+
+/*============ Defines ============*/
+#define READ                    (0x80u)
+#define WATCH_PACKET_SIZE       (64U)
+
+/*============ Local Structures ============*/
+struct watchentry_st
+{
+    uint16_t address;
+    uint8_t  length;            // 0 = entry not used
+    uint8_t  flags;             // WATCH_xxx
+    bool     boSent;            // last_value is what the host has
+    uint8_t  last_value[MAX_WATCH_BYTES];
+};
+
+struct watchlist_st
+{
+    uint8_t  trigger;           // WATCH_TRIGGER_xxx
+    uint16_t period_ms;
+    uint32_t last_trigger_ms;
+    uint16_t sample_number;
+    uint16_t timestamp;
+    uint8_t  next_entry;        // entry to read next in the sample being taken
+    bool     boSampleInProgress;
+    uint16_t skipped;           // triggers that came along while a sample was still being taken/sent
+    uint8_t  packet[WATCH_PACKET_SIZE];
+    uint8_t  packet_length;
+};
+
+/*============ Local Variables ============*/
+struct watchentry_st watch_entries[MAX_WATCH_ENTRIES] = {0};
+struct watchlist_st  watch_list = {0};
+
+/*============ Local Function Prototypes ============*/
+static void TriggerSample(void);
+static void StartPacket(void);
+static void FlushPacket(void);
+
+/*============ Local Functions ============*/
+
+static void TriggerSample(void)
+{
+    watch_list.sample_number++;
+
+    if(watch_list.boSampleInProgress)
+    {
+        watch_list.skipped++;
+        return;
+    }
+
+    watch_list.timestamp          = (uint16_t)__HAL_TIM_GET_COUNTER(&htim16);
+    watch_list.next_entry         = 0;
+    watch_list.boSampleInProgress = true;
+    StartPacket();
+    Scheduler_PostEvent(TASK_WATCH_LIST);
+}
+
+/*-----------------------------------------------------------*/
+
+static void StartPacket(void)
+{
+    memset(watch_list.packet, 0, sizeof(watch_list.packet));
+    watch_list.packet[0] = WATCH_LIST_FLAG;
+    watch_list.packet[2] = (uint8_t)(watch_list.sample_number & 0xFF);
+    watch_list.packet[3] = (uint8_t)(watch_list.sample_number >> 8);
+    watch_list.packet[4] = (uint8_t)(watch_list.timestamp & 0xFF);
+    watch_list.packet[5] = (uint8_t)(watch_list.timestamp >> 8);
+    watch_list.packet_length = WATCH_HEADER_BYTES;
+}
+
+/*-----------------------------------------------------------*/
+
+// copies the packet into the ring (if it has anything in it) and starts the next one
+static void FlushPacket(void)
+{
+    if(watch_list.packet[1] != 0)
+    {
+        memcpy(aXiom_Rx_Buffer[CircularBufferHead], watch_list.packet, sizeof(watch_list.packet));
+        (void)CircularBuffer_Push();   // room is checked before each entry is read
+        Scheduler_PostEvent(TASK_USB_IN);
+    }
+
+    StartPacket();
+}
+
+/*============ Exported Functions ============*/
+
+// sets up (or with a length of 0, removes) one entry, the entry is sent in full on the next sample
+bool WatchList_SetEntry(uint8_t byIndex, uint16_t wdAddress, uint8_t byLength, uint8_t byFlags)
+{
+    if((byIndex >= MAX_WATCH_ENTRIES) || (byLength > MAX_WATCH_BYTES))
+    {
+        return false;
+    }
+
+    watch_entries[byIndex].address = wdAddress;
+    watch_entries[byIndex].length  = byLength;
+    watch_entries[byIndex].flags   = byFlags;
+    watch_entries[byIndex].boSent  = false;
+    watch_list.boSampleInProgress  = false;     // a sample half taken with the old list would confuse the host
+
+    return true;
+}
+
+/*-----------------------------------------------------------*/
+
+bool WatchList_Start(uint8_t byTrigger, uint16_t wdPeriodMs)
+{
+    if((byTrigger > WATCH_TRIGGER_PERIODIC) || ((byTrigger == WATCH_TRIGGER_PERIODIC) && (wdPeriodMs == 0)))
+    {
+        return false;
+    }
+
+    watch_list.trigger            = byTrigger;
+    watch_list.period_ms          = wdPeriodMs;
+    watch_list.last_trigger_ms    = HAL_GetTick();
+    watch_list.boSampleInProgress = false;
+
+    // skipped count is kept when stopping so the host can still read it
+    if(byTrigger != WATCH_TRIGGER_OFF)
+    {
+        watch_list.sample_number = 0;
+        watch_list.skipped       = 0;
+        for(uint8_t i = 0; i < MAX_WATCH_ENTRIES; i++)
+        {
+            watch_entries[i].boSent = false;
+        }
+    }
+
+    return true;
+}
+
+/*-----------------------------------------------------------*/
+
+uint16_t WatchList_GetSkipped(void)
+{
+    return watch_list.skipped;
+}
+
+/*-----------------------------------------------------------*/
+
+// called each time a report has been read off aXiom
+void WatchList_ReportRead(void)
+{
+    if(watch_list.trigger == WATCH_TRIGGER_EVERY_REPORT)
+    {
+        TriggerSample();
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+// called every 1ms
+void WatchList_Tick(void)
+{
+    if((watch_list.trigger == WATCH_TRIGGER_PERIODIC) && ((HAL_GetTick() - watch_list.last_trigger_ms) >= watch_list.period_ms))
+    {
+        watch_list.last_trigger_ms += watch_list.period_ms;     // keeps the period steady even if this tick was late
+        TriggerSample();
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+/* reads the next entry of the sample being taken and packs it in, one entry per call so nothing else is held up for long
+ * returns true if there's more of the sample to go straight away - false (sample still in progress) while waiting for room in the ring */
+bool WatchList_SampleNext(void)
+{
+    struct watchentry_st *entry;
+    uint8_t *pData;
+    uint8_t  byStatus;
+
+    if(watch_list.boSampleInProgress == false)
+    {
+        return false;
+    }
+
+    // a multi-page read relies on aXiom_Tx_Buffer staying put between reads, and a full packet needs somewhere to go
+    if((ProxyMP_TotalNumBytesRx != 0) || CircularBuffer_IsFull())
+    {
+        return false;   // USBInTask posts this again once a slot is freed, BlockReadTask once the multi-page read is done
+    }
+
+    while(watch_list.next_entry < MAX_WATCH_ENTRIES)
+    {
+        entry = &watch_entries[watch_list.next_entry];
+
+        if(entry->length != 0)
+        {
+            break;
+        }
+        watch_list.next_entry++;
+    }
+
+    if(watch_list.next_entry >= MAX_WATCH_ENTRIES)
+    {
+        FlushPacket();
+        watch_list.boSampleInProgress = false;
+        return false;
+    }
+
+    aXiom_Tx_Buffer[0] = (uint8_t)(entry->address & 0xFF);
+    aXiom_Tx_Buffer[1] = (uint8_t)(entry->address >> 8);
+    aXiom_Tx_Buffer[2] = entry->length;
+    aXiom_Tx_Buffer[3] = READ;
+    aXiom_NumBytesTx = 4;
+    aXiom_NumBytesRx = entry->length;
+
+    (void)Comms_Sequence();
+
+    byStatus = aXiom_Rx_Buffer[CircularBufferHead][0];
+    pData    = &aXiom_Rx_Buffer[CircularBufferHead][2];
+
+    if((byStatus != COMMS_OK) && (byStatus != COMMS_OK_NO_READ))
+    {
+        if((watch_list.packet_length + 1) > WATCH_PACKET_SIZE)
+        {
+            FlushPacket();
+        }
+        watch_list.packet[watch_list.packet_length++] = watch_list.next_entry | WATCH_READ_FAILED;
+        watch_list.packet[1]++;
+    }
+    else if(((entry->flags & WATCH_ON_CHANGE) == 0) || (entry->boSent == false) || (memcmp(entry->last_value, pData, entry->length) != 0))
+    {
+        memcpy(entry->last_value, pData, entry->length);
+        entry->boSent = true;
+
+        if((watch_list.packet_length + 1 + entry->length) > WATCH_PACKET_SIZE)
+        {
+            FlushPacket();  // packet's about to be re-used, but the entry's data is safe in last_value
+        }
+        watch_list.packet[watch_list.packet_length++] = watch_list.next_entry;
+        memcpy(&watch_list.packet[watch_list.packet_length], entry->last_value, entry->length);
+        watch_list.packet_length += entry->length;
+        watch_list.packet[1]++;
+    }
+
+    watch_list.next_entry++;
+
+    return true;
+}
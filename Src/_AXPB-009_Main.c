@@ -49,6 +49,12 @@
 #include "Usage_Builder.h"
 #include "Mode_Control.h"
 #include "Timers_and_LEDs.h"
+#include "Report_Queue.h"
+#include "Scheduler.h"
+#include "Frame_Stream.h"
+#include "Watch_List.h"
+#include "Script_Engine.h"
+#include "Usage_Snapshot.h"
 
 /*============ TypeDefs ============*/
 
@@ -58,16 +64,24 @@
 #define PRESS_ENDPOINT          (2)
 #define USB_STARTUP_DELAY_MS    (200)
 
-#define FILLED_BUFFER   (0U)
-#define EMPTIED_BUFFER  (1U)
 
 /*============ Macros ============*/
 
 /*============ Local Variables ============*/
 uint16_t USB_disconnect_count = 0;
+bool     boRxBufferStalled    = false;
 
 /*============ Local Function Prototypes ============*/
-void MoveCircularBuffer(uint8_t operation);
+static void ProxyReadTask(void);
+static void USBInTask(void);
+static void CommandTask(void);
+static void HousekeepingTask(void);
+static void BlockReadTask(void);
+static void FrameStreamTask(void);
+static void WatchListTask(void);
+static void ScriptTask(void);
+static void UsageSnapshotTask(void);
+static void PostRingProducers(void);
 
 /**
   * @brief  The application entry point.
@@ -78,164 +92,349 @@ int main(void)
     // initialise device: peripherals, clocks, GPIO pins, USB, timers etc.
     Device_Init();
 
-    /* Infinite loop */
-    while (1)
+    /* each piece of work the old polling loop did is now a task that only runs when its event has been posted (nIRQ edge, USB IN complete,
+     * command received, 1ms tick), highest priority first */
+    Scheduler_AddTask(TASK_PROXY_READ,   ProxyReadTask);
+    Scheduler_AddTask(TASK_USB_IN,       USBInTask);
+    Scheduler_AddTask(TASK_COMMAND,      CommandTask);
+    Scheduler_AddTask(TASK_HOUSEKEEPING, HousekeepingTask);
+    Scheduler_AddTask(TASK_BLOCK_READ,   BlockReadTask);
+    Scheduler_AddTask(TASK_FRAME_STREAM, FrameStreamTask);
+    Scheduler_AddTask(TASK_WATCH_LIST,   WatchListTask);
+    Scheduler_AddTask(TASK_SCRIPT,       ScriptTask);
+    Scheduler_AddTask(TASK_USAGE_SNAPSHOT, UsageSnapshotTask);
+
+    Script_Init();  // a script stored in flash may be set to run at boot
+
+    Scheduler_PostEvent(TASK_PROXY_READ);   // nIRQ may already be low, in which case there won't be an edge
+    Scheduler_Run();    // never returns
+}
+
+//============= Interrupt handlers =============//
+
+//============= Local Functions =============//
+
+// reads a report off aXiom (posted by the nIRQ edge) and turns it into digitizer/mouse/press reports
+static void ProxyReadTask(void)
+{
+    bool boGotData = 0;
+
+    // only performs a proxy cycle if proxy mode is enabled, a command hasn't been sent by the host AND the connected device has a report available
+    if(((boProxyEnabled == 0) && (boInternalProxy == 0)) || (boCommandWaitingToDecode == 1) || (boProxyInterruptReady == 0) || (HAL_GPIO_ReadPin(GPIOA, nIRQ_Pin) != 0))
     {
-        /* Waits a bit before enabling proxy mode */
-        if(wdUSB1msTick > USB_STARTUP_DELAY_MS)
+        return; // CommandTask and HousekeepingTask post this again when things change (nothing to poll until nIRQ is set up as EXTI again)
+    }
+
+    /* if the host isn't collecting generic proxy reports fast enough, the ring fills up - leave the report on aXiom (nIRQ stays low)
+     * rather than overwrite one that hasn't been sent yet. aXiom will hold onto it until there's room */
+    if((boProxyEnabled == 1) && CircularBuffer_IsFull())
+    {
+        if(boRxBufferStalled == false)
         {
-            setup_proxy_for_digitizer();
-            boUSBTimeoutEnabled = false;
-            boInternalProxy = 1;    // tells us that this is an internal proxy call - don't send generic reports!
+            wdRxBufferOverflows++;  // count each stall once, not every time round
+            boRxBufferStalled = true;
         }
+        return; // USBInTask posts this again once a slot has been freed
+    }
 
-        /* check if host has sent command to bridge */
-        if(boCommandWaitingToDecode == 1)
+    boRxBufferStalled = false;
+
+    boProxyReportAvailable = 1;
+    boGotData = ProxyExecute(false);
+
+    if(boGotData == 1)
+    {
+        if(boProxyEnabled == 1)
         {
-            ProcessTBPCommand();
+            /* host requested proxy mode so send reports up the generic endpoint (internal proxy may be running too if commands are concurrent) - unless the host has said it doesn't want this type of report,
+             * in which case the slot is simply re-used for the next read */
+            if(ProxyReportWanted())
+            {
+                (void)CircularBuffer_Push();   // can't be full, checked above
+            }
         }
 
-        // send response to host
-        if((boGenericTBPResponseWaiting == 1) && (USBD_GENERIC_HID_GetState(&hUsbDeviceFS) == USB_HID_IDLE))
+        // host may want a (3D) frame read, or the watch list sampled, on every report
+        FrameStream_ReportRead();
+        WatchList_ReportRead();
+
+        if(boMouseEnabled == true)  // only enable digitizer/mouse reports if we're in the correct mode!
         {
-            Send_USB_Report(GENERIC, &hUsbDeviceFS, pTBPCommandReport, USBD_GENERIC_HID_REPORT_IN_SIZE);
-            boGenericTBPResponseWaiting = 0;
+            if(BridgeMode == PARALLEL_DIGITIZER) // check if we're in multipoint digitizer mode
+            {
+                MultiPointDigitizer();
+            }
+            else if(BridgeMode == ABSOLUTE_MOUSE)
+            {
+                MouseDigitizer();
+            }
         }
 
+        // press endpoint is always active so this is always executed
+        BuildPressReportFromPressAndTouch();
+
+        Scheduler_PostEvent(TASK_USB_IN);
+    }
+
+    // aXiom keeps nIRQ low while it has more reports queued, there's no new edge for those
+    if((boProxyInterruptReady == 1) && (HAL_GPIO_ReadPin(GPIOA, nIRQ_Pin) == 0))
+    {
+        Scheduler_PostEvent(TASK_PROXY_READ);
+    }
+}
 
-        if((boPressTBPResponseWaiting == 1) && (USBD_PRESS_HID_GetState(&hUsbDeviceFS) == USB_HID_IDLE))
+/*-----------------------------------------------------------*/
+
+/* Linux won't accept/deal with a packet unless an application is run to handle it so the code will lock up if the endpoint checks are tied together
+ * (like they used to be)
+ * e.g. Press endpoint always sends packets and will be a hog until the host has received it, which Linux won't without an application running
+ * Instead, each endpoint needs an independent check that blocks a new packet from being sent if one is in process, but doesn't prevent other endpoints
+ * from sending. Posted whenever something is queued and when an IN transfer completes */
+static void USBInTask(void)
+{
+    // send response to host
+    if((boGenericTBPResponseWaiting == 1) && (USBD_GENERIC_HID_GetState(&hUsbDeviceFS) == USB_HID_IDLE))
+    {
+        // nothing is sent while reports are blocked - the response stays waiting (and its FIFO entry held) until it really goes
+        if(Send_USB_Report(GENERIC, &hUsbDeviceFS, pTBPCommandReport, USBD_GENERIC_HID_REPORT_IN_SIZE) == USBD_OK)
+        {
+            boGenericTBPResponseWaiting = 0;
+            CommandFIFO_ResponseSent();
+        }
+    }
+
+    if((boPressTBPResponseWaiting == 1) && (USBD_PRESS_HID_GetState(&hUsbDeviceFS) == USB_HID_IDLE))
+    {
+        if(Send_USB_Report(PRESS, &hUsbDeviceFS, pTBPCommandReport, USBD_PRESS_HID_REPORT_IN_SIZE) == USBD_OK)
         {
-            Send_USB_Report(PRESS, &hUsbDeviceFS, pTBPCommandReport, USBD_PRESS_HID_REPORT_IN_SIZE);
             boPressTBPResponseWaiting = 0;
+            CommandFIFO_ResponseSent();
         }
+    }
 
-        /* send reports to host flat out! */
-        // only performs a proxy cycle if proxy mode is enabled, a command hasn't been sent by the host AND the connected device has a report available
-        if(((boProxyEnabled == 1) || (boInternalProxy == 1)) && (boCommandWaitingToDecode == 0) && (HAL_GPIO_ReadPin(GPIOA, nIRQ_Pin) == 0))
+    // checked before the packet is built - packing releases the slots it takes before the packet is sent
+    if((CircularBuffer_IsEmpty() == false) && (boBlockReports == 0) && (USBD_GENERIC_HID_GetState(&hUsbDeviceFS) == USB_HID_IDLE) && (usb_remote_wake_state == RESUMED))
+    {
+        uint8_t *pReport = GetNextProxyPacket();   // either the slot at the tail, or several reports packed together (slots already released)
+
+        Send_USB_Report(GENERIC, &hUsbDeviceFS, pReport, USBD_GENERIC_HID_REPORT_IN_SIZE);
+
+        if(pReport == aXiom_Rx_Buffer[CircularBufferTail])
         {
-            bool boGotData = 0;
+            CircularBuffer_Pop();
+        }
 
-            boProxyReportAvailable = 1;
-            boGotData = ProxyExecute(false);
+        // there's room in the ring again for anything that had stalled on it
+        Scheduler_PostEvent(TASK_PROXY_READ);
+        PostRingProducers();
+    }
+
+    // each endpoint has its own queue so a host that's slow reading one (e.g. press) never holds up the others
+    if((USBD_MOUSE_HID_GetState(&hUsbDeviceFS) == USB_HID_IDLE) && (usb_remote_wake_state == RESUMED))
+    {
+        uint8_t  byReportLength;
+        uint8_t *pReport = ReportQueue_Peek(&mouse_report_queue, &byReportLength);
 
-            if(boGotData == 1)
+        if(pReport != NULL)
+        {
+            if(Send_USB_Report(MOUSE, &hUsbDeviceFS, pReport, byReportLength) == USBD_OK)
             {
-                if(boInternalProxy == 0)
-                {
-                    /* host requested proxy mode so send reports up the generic endpoint */
-                    boGenericReportToSend = 1;
-
-                    MoveCircularBuffer(FILLED_BUFFER);
-                }
-
-                if(boMouseEnabled == true)  // only enable digitizer/mouse reports if we're in the correct mode!
-                {
-                    if(BridgeMode == PARALLEL_DIGITIZER) // check if we're in multipoint digitizer mode
-                    {
-                        MultiPointDigitizer();
-                    }
-                    else if(BridgeMode == ABSOLUTE_MOUSE)
-                    {
-                        MouseDigitizer();
-                    }
-                }
-
-                // press endpoint is always active so this is always executed
-                BuildPressReportFromPressAndTouch();
+                ReportQueue_Pop(&mouse_report_queue);
+            }
+        }
+    }
 
+    if((USBD_PRESS_HID_GetState(&hUsbDeviceFS) == USB_HID_IDLE) && (usb_remote_wake_state == RESUMED))
+    {
+        uint8_t  byReportLength;
+        uint8_t *pReport = ReportQueue_Peek(&press_report_queue, &byReportLength);
+
+        if(pReport != NULL)
+        {
+            if(Send_USB_Report(PRESS, &hUsbDeviceFS, pReport, byReportLength) == USBD_OK)
+            {
+                ReportQueue_Pop(&press_report_queue);
             }
         }
-        else if(ProxyMP_TotalNumBytesRx != 0)   // if this variable is non-zero, it means a 3D read is happening so enter here
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+// posted from the OUT endpoint callbacks when the host sends a command, and once a response has gone out (next command can run)
+static void CommandTask(void)
+{
+    /* run the oldest command the host has sent */
+    CommandFIFO_Service();
+
+    // response (if any) needs sending, and proxy/block reads may have been started or held off while the command was waiting
+    Scheduler_PostEvent(TASK_USB_IN);
+    Scheduler_PostEvent(TASK_PROXY_READ);
+    Scheduler_PostEvent(TASK_BLOCK_READ);
+}
+
+/*-----------------------------------------------------------*/
+
+// posted every 1ms from SysTick
+static void HousekeepingTask(void)
+{
+    /* Waits a bit before enabling proxy mode */
+    if(wdUSB1msTick > USB_STARTUP_DELAY_MS)
+    {
+        setup_proxy_for_digitizer();
+        boUSBTimeoutEnabled = false;
+        boInternalProxy = 1;    // tells us that this is an internal proxy call - don't send generic reports!
+        if(boProxyInterruptReady == 0)
         {
-            bool boGotData = 0;
+            InitProxyInterruptMode();   // the command that stopped proxy de-initialised the pin
+        }
+        Scheduler_PostEvent(TASK_PROXY_READ);
+    }
 
-            // will continue to return 'false' until transfer is complete and host has received a payload
-            boGotData = ProxyExecute(true);
+    // absolute mouse right click and remote wakeup signalling are timed here rather than blocking the proxy path
+    MouseRightClickTask();
+    RemoteWakeupTask();
+    FrameStream_Tick();
+    WatchList_Tick();
+    WaitForCondition_Tick();
+    BlockWriteData_Tick();
+    Script_Tick();
+
+    // backstop - picks up anything that was queued without an event being posted (e.g. host resuming from suspend)
+    Scheduler_PostEvent(TASK_USB_IN);
+    if(boCommandWaitingToDecode == 1)
+    {
+        Scheduler_PostEvent(TASK_COMMAND);
+    }
+    if((boProxyInterruptReady == 1) && (HAL_GPIO_ReadPin(GPIOA, nIRQ_Pin) == 0))
+    {
+        Scheduler_PostEvent(TASK_PROXY_READ);
+    }
+}
 
-            //waits for data to be read from device and sent to host before preparing the next read
-            if(boGotData == true)
-            {
-                uint8_t byPagesMovedThrough;
-                uint8_t byBytesOffsetIntoPage;
+/*-----------------------------------------------------------*/
 
-                MoveCircularBuffer(FILLED_BUFFER);
+/* host requested multi-page (3D) read or a CRC of a region. Each chunk is read once the previous one has been sent (proxy and the other
+ * ring producers are held off during a multi-page read, so it's the only thing in the ring) - USBInTask posts this again once it has
+ * gone, so nothing waits in here for the host */
+static void BlockReadTask(void)
+{
+    bool boGotData = 0;
 
-                // if we're doing 3D data we don't care about any other endpoint so fine to wait here for the hardware to become free
-                while(USBD_GENERIC_HID_GetState(&hUsbDeviceFS) == USB_HID_BUSY);
-                Send_USB_Report(GENERIC, &hUsbDeviceFS, aXiom_Rx_Buffer[CircularBufferTail], USBD_GENERIC_HID_REPORT_IN_SIZE);
-                MoveCircularBuffer(EMPTIED_BUFFER);
+    if(RegionCRC_ReadNext())
+    {
+        Scheduler_PostEvent(TASK_BLOCK_READ);
+    }
 
-                ProxyMP_TotalNumBytesRx -= aXiom_NumBytesRx;  //subract the number of bytes just read --> leaves how may bytes left to read
-                wdProxyMP_BytesRead += aXiom_NumBytesRx;  // also keeps track of number of bytes read, but counts up from 0 (allows us to set starting page and offset correctly for next transfer)
+    if((ProxyMP_TotalNumBytesRx == 0) || (CircularBuffer_IsEmpty() == false))
+    {
+        return;
+    }
 
-                // set no. read bytes to either 58 (maximum read size) or however many bytes are left
-                // --> 3 bytes come from 'nonsense' at end of read(?)
-                //     2 bytes for header (command and comms status)
-                //     1 byte to make it match what TH2 is expecting!?
-                aXiom_NumBytesRx = (ProxyMP_TotalNumBytesRx < NUMBYTES_RX_MP) ? ProxyMP_TotalNumBytesRx : NUMBYTES_RX_MP;
+    // a proxy report waiting on aXiom goes first (same as the old loop)
+    if(((boProxyEnabled == 1) || (boInternalProxy == 1)) && (boCommandWaitingToDecode == 0) && (boProxyInterruptReady == 1) && (HAL_GPIO_ReadPin(GPIOA, nIRQ_Pin) == 0))
+    {
+        Scheduler_PostEvent(TASK_BLOCK_READ);
+        return;
+    }
 
-                // calculate the next starting address and offset required (e.g. start at 0, read 64, so new starting address is 0x0064)
-                byPagesMovedThrough   = wdProxyMP_BytesRead / (byProxyMP_PageLength == 0 ? (uint16_t)256 : (uint16_t)byProxyMP_PageLength);
-                byBytesOffsetIntoPage = wdProxyMP_BytesRead % (byProxyMP_PageLength == 0 ? (uint16_t)256 : (uint16_t)byProxyMP_PageLength);
+    // will continue to return 'false' until transfer is complete
+    boGotData = ProxyExecute(true);
 
-                // set address bytes for Tx
-                aXiom_Tx_Buffer[0] = (uint8_t)((wdProxyMP_AddrStart & 0xFF) + byBytesOffsetIntoPage);
-                aXiom_Tx_Buffer[1] = (uint8_t)((wdProxyMP_AddrStart >> 8) + byPagesMovedThrough);
-            }
-        }
+    if(boGotData == false)
+    {
+        Scheduler_PostEvent(TASK_BLOCK_READ);
+    }
+    else
+    {
+        uint8_t byPagesMovedThrough;
+        uint8_t byBytesOffsetIntoPage;
 
-        /* Linux won't accept/deal with a packet unless an application is run to handle it so the code will lock up if the endpoint checks are tied together
-         * (like they used to be)
-         * e.g. Press endpoint always sends packets and will be a hog until the host has received it, which Linux won't without an application running
-         * Instead, each endpoint needs an independent check that blocks a new packet from being sent if one is in process, but doesn't prevent other endpoints
-         * from sending */
-        if((boGenericReportToSend == 1) && (USBD_GENERIC_HID_GetState(&hUsbDeviceFS) == USB_HID_IDLE) && (usb_remote_wake_state == RESUMED))
-        {
-            Send_USB_Report(GENERIC, &hUsbDeviceFS, aXiom_Rx_Buffer[CircularBufferTail], USBD_GENERIC_HID_REPORT_IN_SIZE);
-            MoveCircularBuffer(EMPTIED_BUFFER);
+        (void)CircularBuffer_Push();   // can't be full, checked above
+        Scheduler_PostEvent(TASK_USB_IN);
 
-            if(CircularBufferTail == CircularBufferHead)
-            {
-                boGenericReportToSend = 0;
-            }
-        }
+        ProxyMP_TotalNumBytesRx -= aXiom_NumBytesRx;  //subract the number of bytes just read --> leaves how may bytes left to read
+        wdProxyMP_BytesRead += aXiom_NumBytesRx;  // also keeps track of number of bytes read, but counts up from 0 (allows us to set starting page and offset correctly for next transfer)
 
-        if((boMouseReportToSend == 1) && (USBD_MOUSE_HID_GetState(&hUsbDeviceFS) == USB_HID_IDLE) && (usb_remote_wake_state == RESUMED))
-        {
-            Send_USB_Report(MOUSE, &hUsbDeviceFS, usb_hid_mouse_report_in, byMouseReportLength);
-            boMouseReportToSend = 0;
-        }
+        // set no. read bytes to either 58 (maximum read size) or however many bytes are left
+        // --> 3 bytes come from 'nonsense' at end of read(?)
+        //     2 bytes for header (command and comms status)
+        //     1 byte to make it match what TH2 is expecting!?
+        aXiom_NumBytesRx = (ProxyMP_TotalNumBytesRx < NUMBYTES_RX_MP) ? ProxyMP_TotalNumBytesRx : NUMBYTES_RX_MP;
+
+        // calculate the next starting address and offset required (e.g. start at 0, read 64, so new starting address is 0x0064)
+        byPagesMovedThrough   = wdProxyMP_BytesRead / (byProxyMP_PageLength == 0 ? (uint16_t)256 : (uint16_t)byProxyMP_PageLength);
+        byBytesOffsetIntoPage = wdProxyMP_BytesRead % (byProxyMP_PageLength == 0 ? (uint16_t)256 : (uint16_t)byProxyMP_PageLength);
+
+        // set address bytes for Tx
+        aXiom_Tx_Buffer[0] = (uint8_t)((wdProxyMP_AddrStart & 0xFF) + byBytesOffsetIntoPage);
+        aXiom_Tx_Buffer[1] = (uint8_t)((wdProxyMP_AddrStart >> 8) + byPagesMovedThrough);
 
-        if((boPressReportToSend == 1) && (USBD_PRESS_HID_GetState(&hUsbDeviceFS) == USB_HID_IDLE) && (usb_remote_wake_state == RESUMED))
+        if(ProxyMP_TotalNumBytesRx == 0)
         {
-            Send_USB_Report(PRESS, &hUsbDeviceFS, usb_hid_press_report_in, USBD_PRESS_HID_REPORT_IN_SIZE);
-            boPressReportToSend = 0;
+            PostRingProducers();    // streams/snapshots don't read aXiom while a multi-page read is in progress
         }
+    }
+}
+
+/*-----------------------------------------------------------*/
+
+/* tasks that fill the ring stop (without reposting) while it's full or a multi-page read is in progress, rather than spinning
+ * and starving the tasks below them - they're posted again from here. Each returns straight away if it has nothing to do */
+static void PostRingProducers(void)
+{
+    Scheduler_PostEvent(TASK_BLOCK_READ);
+    Scheduler_PostEvent(TASK_FRAME_STREAM);
+    Scheduler_PostEvent(TASK_WATCH_LIST);
+    Scheduler_PostEvent(TASK_USAGE_SNAPSHOT);
+}
+
+/*-----------------------------------------------------------*/
 
-        // turns off the LEDs if a recent comms event has turned them on
-        LED_control();
-        comms_detect_inactivity();
+// posted when a streamed frame is triggered, reposts itself until the whole frame is in the ring (USBInTask sends it)
+static void FrameStreamTask(void)
+{
+    if(FrameStream_ReadNext())
+    {
+        Scheduler_PostEvent(TASK_FRAME_STREAM);
     }
 }
 
-//============= Interrupt handlers =============//
+/*-----------------------------------------------------------*/
 
-//============= Local Functions =============//
+// posted when the watch list is triggered, reposts itself until every entry has been read and packed
+static void WatchListTask(void)
+{
+    if(WatchList_SampleNext())
+    {
+        Scheduler_PostEvent(TASK_WATCH_LIST);
+    }
+}
+
+/*-----------------------------------------------------------*/
 
-void MoveCircularBuffer(uint8_t operation)
+// posted when the script is started (and every 1ms while it's running), reposts itself until it finishes or has to wait
+static void ScriptTask(void)
 {
-    if(operation == FILLED_BUFFER)
+    if(Script_Step())
     {
-        CircularBufferHead ++;
-        CircularBufferHead %= MAX_NUM_RX_BUFFERS;
+        Scheduler_PostEvent(TASK_SCRIPT);
     }
-    else //operation == EMPTIED_BUFFER
+}
+
+/*-----------------------------------------------------------*/
+
+// posted when the host asks for a usage snapshot, reposts itself until every usage is in the ring (USBInTask sends it)
+static void UsageSnapshotTask(void)
+{
+    if(UsageSnapshot_ReadNext())
     {
-        CircularBufferTail ++;
-        CircularBufferTail %= MAX_NUM_RX_BUFFERS;
+        Scheduler_PostEvent(TASK_USAGE_SNAPSHOT);
     }
 }
 
+/*-----------------------------------------------------------*/
+
 /**
   * @brief  This function is executed in case of error occurrence.
   * @retval None